@@ -53,6 +53,7 @@ INSERT IGNORE INTO users(username,password_plain) VALUES
 CREATE TABLE IF NOT EXISTS sessions (
   token CHAR(64) PRIMARY KEY,
   user_id INT NOT NULL,
+  game_id INT NULL,
   created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
   last_seen TIMESTAMP DEFAULT CURRENT_TIMESTAMP,
   FOREIGN KEY (user_id) REFERENCES users(id)
@@ -64,6 +65,8 @@ CREATE TABLE IF NOT EXISTS games (
   state_json MEDIUMTEXT NOT NULL,
   current_draft_A VARCHAR(4) DEFAULT NULL,
   current_draft_B VARCHAR(4) DEFAULT NULL,
+  version INT NOT NULL DEFAULT 0,
+  map_id INT NOT NULL DEFAULT 1,
   created_at TIMESTAMP DEFAULT CURRENT_TIMESTAMP
 );
 
@@ -141,52 +144,79 @@ CREATE TABLE IF NOT EXISTS sightings (
 );
 
 -- ALTER TABLE sessions ADD COLUMN last_seen TIMESTAMP DEFAULT CURRENT_TIMESTAMP;
+-- ALTER TABLE sessions ADD COLUMN game_id INT NULL;
+-- ALTER TABLE games ADD COLUMN version INT NOT NULL DEFAULT 0;
 
 
--- map metadata per game
+-- Map templates. The map tables below hold each template once; games
+-- refer to one by games.map_id and keep only what differs for them in
+-- system_overlays.
+CREATE TABLE IF NOT EXISTS maps (
+  id INT NOT NULL PRIMARY KEY,
+  name VARCHAR(64) NOT NULL
+);
+
 CREATE TABLE IF NOT EXISTS star_systems (
-  game_id INT NOT NULL,
+  map_id INT NOT NULL,
   hex_id VARCHAR(8) NOT NULL,
   name VARCHAR(64) NOT NULL,
   is_base TINYINT NOT NULL DEFAULT 0,
   base_owner CHAR(1) NULL,
-  PRIMARY KEY (game_id, name),
-  INDEX (game_id, hex_id),
-  INDEX (game_id, is_base),
-  INDEX (game_id, base_owner)
+  PRIMARY KEY (map_id, name),
+  INDEX (map_id, hex_id),
+  INDEX (map_id, is_base),
+  INDEX (map_id, base_owner)
 );
 
 CREATE TABLE IF NOT EXISTS warplines (
-  game_id INT NOT NULL,
+  map_id INT NOT NULL,
   id INT NOT NULL AUTO_INCREMENT,
   a_hex VARCHAR(8) NOT NULL,
   b_hex VARCHAR(8) NOT NULL,
   PRIMARY KEY (id),
-  INDEX (game_id),
-  INDEX (game_id, a_hex),
-  INDEX (game_id, b_hex)
+  INDEX (map_id),
+  INDEX (map_id, a_hex),
+  INDEX (map_id, b_hex)
 );
 
 
 CREATE TABLE IF NOT EXISTS hexes (
-  game_id INT NOT NULL,
+  map_id INT NOT NULL,
   hex_id VARCHAR(8) NOT NULL,
   q INT NOT NULL,
   r INT NOT NULL,
-  PRIMARY KEY (game_id, hex_id),
-  INDEX (game_id, q),
-  INDEX (game_id, r)
+  PRIMARY KEY (map_id, hex_id),
+  INDEX (map_id, q),
+  INDEX (map_id, r)
 );
 
 CREATE TABLE IF NOT EXISTS warpline_hexes (
-  game_id INT NOT NULL,
+  map_id INT NOT NULL,
   warpline_id INT NOT NULL,
   hex_id VARCHAR(8) NOT NULL,
-  PRIMARY KEY (game_id, warpline_id, hex_id),
-  INDEX (game_id, hex_id),
-  INDEX (game_id, warpline_id)
+  PRIMARY KEY (map_id, warpline_id, hex_id),
+  INDEX (map_id, hex_id),
+  INDEX (map_id, warpline_id)
 );
 
+-- Per-game changes to a template's systems (NULL base_owner: unowned).
+CREATE TABLE IF NOT EXISTS system_overlays (
+  game_id INT NOT NULL,
+  name VARCHAR(64) NOT NULL,
+  base_owner CHAR(1) NULL,
+  PRIMARY KEY (game_id, name),
+  FOREIGN KEY (game_id) REFERENCES games(id)
+);
+
+-- Upgrading from per-game map rows (the old game_id column becomes the
+-- template id; games then all play on template 1):
+-- ALTER TABLE games ADD COLUMN map_id INT NOT NULL DEFAULT 1;
+-- ALTER TABLE star_systems CHANGE game_id map_id INT NOT NULL;
+-- ALTER TABLE warplines CHANGE game_id map_id INT NOT NULL;
+-- ALTER TABLE hexes CHANGE game_id map_id INT NOT NULL;
+-- ALTER TABLE warpline_hexes CHANGE game_id map_id INT NOT NULL;
+-- INSERT INTO maps(id,name) VALUES(1,'Kepler');
+
 
 -- ships.at_system should match star_systems.name when on a system.
 
@@ -1,4 +1,4 @@
--- Seed data for Kepler map (game_id=1)
+-- Seed data for the Kepler map template (map_id=1)
 -- Run this after schema.sql.
 -- Recommended invocation from this directory:
 --   mysql --local-infile=1 -u <user> -p borealis < schema.sql
@@ -6,20 +6,22 @@
 
 START TRANSACTION;
 
--- DELETE FROM warplines WHERE game_id=1;
--- DELETE FROM star_systems WHERE game_id=1;
+-- DELETE FROM warplines WHERE map_id=1;
+-- DELETE FROM star_systems WHERE map_id=1;
+
+INSERT INTO maps(id,name) VALUES(1,'Kepler');
 
 LOAD DATA LOCAL INFILE 'star_systems.csv'
 INTO TABLE star_systems
 FIELDS TERMINATED BY ','
 LINES TERMINATED BY '\n'
-(game_id, hex_id, name, is_base, base_owner);
+(map_id, hex_id, name, is_base, base_owner);
 
 LOAD DATA LOCAL INFILE 'warplines.csv'
 INTO TABLE warplines
 FIELDS TERMINATED BY ','
 LINES TERMINATED BY '\n'
-(game_id, a_hex, b_hex);
+(map_id, a_hex, b_hex);
 
 
 LOAD DATA LOCAL INFILE 'hexes.csv'
@@ -27,14 +29,14 @@ INTO TABLE hexes
 FIELDS TERMINATED BY ','
 LINES TERMINATED BY '
 '
-(game_id, hex_id, q, r);
+(map_id, hex_id, q, r);
 
 LOAD DATA LOCAL INFILE 'warpline_hexes.csv'
 INTO TABLE warpline_hexes
 FIELDS TERMINATED BY ','
 LINES TERMINATED BY '
 '
-(game_id, warpline_id, hex_id);
+(map_id, warpline_id, hex_id);
 
 
 COMMIT;
@@ -0,0 +1,67 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __COMBAT_H__
+#define __COMBAT_H__
+
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "typs.h"
+
+// Deterministic combat, by RULES.md 7.3 as Position::make_move and the
+// tablebase play it: every fleet in a system holding ships of both sides is
+// removed, along with anything racked in it. There are no partial victories.
+
+// All combatants of a turn, across every contested system, as parallel
+// arrays. Units must be added grouped by engagement.
+class CombatBatch
+{
+  public:
+    std::vector<int> engagement;
+    std::vector<int> side;
+    // results
+    std::vector<char> destroyed;
+
+  public:
+    int add(int engagement_id, int side_index);
+    void resolve();
+    int size() const
+    {
+        return (int)engagement.size();
+    }
+};
+
+std::string resolve_combat(Db *db, GameState &s);
+
+#endif
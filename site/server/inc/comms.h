@@ -33,15 +33,33 @@
 #ifndef __COMMS_H__
 #define __COMMS_H__
 
+#include <memory>
 #include <string>
 
 #include "db.h"
+#include "encode.h"
 #include "typs.h"
 
 AuthContext require_auth(Db *db, const HttpRequest *req, HttpResponse *resp);
+int session_game(Db *db, const std::string &token);
+int create_game(Db *db);
 std::string pick_bearer(const HttpRequest *req);
+bool not_modified(const HttpRequest *req, HttpResponse *resp,
+                  const std::string &etag);
+bool wants_cbor(const HttpRequest *req);
+std::unique_ptr<Encoder> response_encoder(const HttpRequest *req);
+void set_body(HttpResponse *resp, Encoder &e);
+std::string body_field(const HttpRequest *req, const std::string &key);
 std::string http_serialize(const HttpResponse &r);
-HttpRequest http_parse(int fd);
+bool http_complete(const std::string &data);
+HttpRequest http_parse(const std::string &data);
 void dispatch_request(const HttpRequest *req, Db *db, HttpResponse *resp);
+void serve_request(int fd, const HttpRequest &req, Db *db);
+// Writes the reply and closes 'fd'. A client that has not taken all of it
+// within KH_SEND_TIMEOUT seconds is cut off, so a reader that stalls
+// cannot hold the shard thread sending to it.
+#define KH_SEND_TIMEOUT 10
+#define KH_SEND_PIECE 65536 // bytes per sendfile() call
+void send_response(int fd, const HttpResponse &resp);
 
 #endif
@@ -0,0 +1,54 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __COMPLETE_H__
+#define __COMPLETE_H__
+
+#include "db.h"
+#include "typs.h"
+
+// GET /api/complete?prefix=[&limit=]: completions for the last word of a
+// command line, in any case: the star systems of the caller's map and the
+// codes of the caller's ships and drafts that begin with 'prefix', at most
+// 'limit' (KH_COMPLETE_LIMIT by default, KH_COMPLETE_MAX at most) of each.
+//
+// System names come from the map template's NameIndex. Ship codes are
+// indexed per game and side, and rebuilt when the game's version moves;
+// the KH_COMPLETE_CACHE most recently used of those are kept.
+
+#define KH_COMPLETE_LIMIT 20
+#define KH_COMPLETE_MAX 200
+#define KH_COMPLETE_CACHE 1024
+
+void handle_complete(const HttpRequest *req, Db *db, HttpResponse *resp);
+
+#endif
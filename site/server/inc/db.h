@@ -98,6 +98,12 @@ class Db
         return out;
     }
 
+    // Rows changed by the last UPDATE/INSERT/DELETE.
+    unsigned long long affected()
+    {
+        return mysql_affected_rows(c);
+    }
+
     std::string esc(const std::string &s)
     {
         std::string out;
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __ENCODE_H__
+#define __ENCODE_H__
+
+#include <string>
+#include <vector>
+
+// API payload writers. Handlers describe a payload once through Encoder
+// calls; JsonEncoder and CborEncoder (RFC 8949) turn the same calls into
+// their format. Objects and arrays are written as a sequence of key/value
+// or value calls between begin_* and end_*.
+
+class Encoder
+{
+  public:
+    virtual ~Encoder() {}
+    virtual const char *content_type() const = 0;
+    virtual void begin_object() = 0;
+    virtual void end_object() = 0;
+    virtual void begin_array() = 0;
+    virtual void end_array() = 0;
+    virtual void key(const std::string &k) = 0;
+    virtual void str(const std::string &v) = 0;
+    virtual void num(long long v) = 0;
+    virtual void boolean(bool v) = 0;
+
+    std::string out;
+};
+
+class JsonEncoder : public Encoder
+{
+  public:
+    const char *content_type() const { return "application/json"; }
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+    void key(const std::string &k);
+    void str(const std::string &v);
+    void num(long long v);
+    void boolean(bool v);
+
+  private:
+    void value();
+    std::vector<bool> first; // per open container: nothing written yet
+    bool keyed = false;      // a key was just written
+};
+
+// Containers are written with indefinite lengths, so the encoder never
+// needs to know member counts up front.
+class CborEncoder : public Encoder
+{
+  public:
+    const char *content_type() const { return "application/cbor"; }
+    void begin_object();
+    void end_object();
+    void begin_array();
+    void end_array();
+    void key(const std::string &k);
+    void str(const std::string &v);
+    void num(long long v);
+    void boolean(bool v);
+
+  private:
+    void head(int major, unsigned long long v);
+};
+
+// Text value of 'key' in a CBOR map at the top of 'body'; "" if the body
+// is not a map, the key is missing or its value is not a text string.
+std::string cbor_get_string(const std::string &body, const std::string &key);
+
+#endif
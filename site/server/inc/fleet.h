@@ -0,0 +1,79 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __FLEET_H__
+#define __FLEET_H__
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "typs.h"
+
+// One owner's ships with the rack hierarchy resolved: every warpship owns
+// the systemships racked in it, and a racked ship's location is its
+// carrier's, so moving a carrier moves its cargo without touching them.
+class Fleet
+{
+  public:
+    std::vector<ShipRow> ships; // ordered by ship code
+    std::vector<int> carrier;   // ship -> carrying warpship, or -1
+    std::vector<std::vector<int>> rack; // warpship -> racked ships
+
+  public:
+    void build(const std::vector<ShipRow> &rows);
+
+    int find(const std::string &code) const
+    {
+        auto it = index.find(code);
+        return (it == index.end()) ? -1 : it->second;
+    }
+
+    const std::vector<int> &cargo(int i) const
+    {
+        return rack[i];
+    }
+
+    const std::string &location(int i) const
+    {
+        return (carrier[i] >= 0) ? ships[carrier[i]].at_system
+                                 : ships[i].at_system;
+    }
+
+  private:
+    std::map<std::string, int> index;
+};
+
+Fleet load_fleet(Db *db, int game_id, char owner);
+
+#endif
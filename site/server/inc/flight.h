@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __FLIGHT_H__
+#define __FLIGHT_H__
+
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+// Single-flight: concurrent calls for the same key share one computation.
+// The first caller runs it; callers arriving while it is in flight wait for
+// and receive the same result (or exception). Nothing is kept afterwards,
+// so later calls compute afresh.
+template <class T>
+class SingleFlight
+{
+  public:
+    typedef std::shared_ptr<const T> Result;
+
+    template <class F>
+    Result run(const std::string &key, F fn)
+    {
+        std::promise<Result> p;
+        std::shared_future<Result> f;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> g(mu);
+            auto it = calls.find(key);
+            if (it != calls.end())
+                f = it->second;
+            else
+            {
+                f = p.get_future().share();
+                calls[key] = f;
+                leader = true;
+            }
+        }
+        if (!leader)
+            return f.get();
+
+        try
+        {
+            p.set_value(fn());
+        }
+        catch (...)
+        {
+            p.set_exception(std::current_exception());
+        }
+        {
+            std::lock_guard<std::mutex> g(mu);
+            calls.erase(key);
+        }
+        return f.get();
+    }
+
+  private:
+    std::mutex mu;
+    std::map<std::string, std::shared_future<Result>> calls;
+};
+
+#endif
@@ -38,19 +38,30 @@
 #include "db.h"
 #include "typs.h"
 
+// Thrown by save_game when the stored game is no longer at the version the
+// caller loaded.
+class VersionConflict : public std::runtime_error
+{
+  public:
+    explicit VersionConflict(int game_id)
+        : std::runtime_error("game " + std::to_string(game_id) +
+                             " was modified concurrently")
+    {
+    }
+};
+
 GameState load_game(Db *db, int game_id);
-int count_racked_in(Db *db, int game_id, char owner,
-                    const std::string &warpship_code);
 void insert_ship(Db *db, int game_id, char owner, const ShipRow &s);
 void set_current_draft(Db *db, int game_id, char owner,
                        const std::string &code_or_null);
 bool draft_exists(Db *db, int game_id, char owner, const std::string &code);
 std::string get_current_draft(Db *db, int game_id, char owner);
 GameState new_game_state_for_scenario(const std::string &scenario);
+int vp_needed(const std::string &scenario);
 void apply_start_of_turn(Db *db, GameState &s);
 void advance_next(Db *db, GameState &s);
 int next_event_seq(Db *db, int game_id);
-void save_game(Db *db, const GameState &s);
+void save_game(Db *db, GameState &s);
 bool ship_exists(Db *db, int game_id, char owner, const std::string &code);
 std::vector<DraftRow> load_drafts(Db *db, int game_id, char owner);
 DraftRow load_draft(Db *db, int game_id, char owner, const std::string &code);
@@ -64,4 +75,5 @@ void update_ship_location(Db *db, int game_id, char owner,
                           const std::string &code, const std::string &at_system,
                           const std::string &at_hex,
                           const std::string &racked_in);
+void delete_ship(Db *db, int game_id, char owner, const std::string &code);
 #endif
@@ -0,0 +1,59 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __INTAKE_H__
+#define __INTAKE_H__
+
+#include <csignal>
+
+class ShardPool;
+
+// Request intake: each worker process runs one epoll loop that accepts
+// connections and reads requests without blocking, so a slow or trickling
+// client holds a buffer here rather than a shard thread. Only complete
+// requests are handed to the shards (shard.h), with the connection
+// switched back to blocking mode for the reply; send_response() bounds how
+// long that may take.
+//
+// A request has KH_INTAKE_TIMEOUT seconds from its accept to arrive, and
+// gets 413 past KH_INTAKE_MAX_REQUEST bytes. Connections beyond
+// KH_INTAKE_MAX_CONNS being read at once are closed at accept.
+
+#define KH_INTAKE_TIMEOUT 5
+#define KH_INTAKE_MAX_REQUEST (1024 * 1024)
+#define KH_INTAKE_MAX_CONNS 4096
+
+// Serves 'srv' until *stop is set; then stops accepting and returns once
+// the requests still being read are handed over or have timed out.
+void run_intake(int srv, ShardPool &pool, volatile sig_atomic_t *stop);
+
+#endif
@@ -0,0 +1,63 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __LISTENER_H__
+#define __LISTENER_H__
+
+#include <string>
+#include <vector>
+
+#include "typs.h"
+
+// Listening sockets, worker processes and zero-downtime restarts.
+//
+// With --workers N the parent opens N TCP listeners on the same address
+// (SO_REUSEPORT, so the kernel spreads connections over them) and forks one
+// worker per listener. The parent then only supervises: it restarts
+// workers that die and, with --handoff <path>, hands its listeners to a
+// new binary started with --takeover <path>. The new parent receives the
+// sockets over the Unix socket (SCM_RIGHTS) and starts its own workers on
+// them; the old workers stop accepting, finish what they have queued and
+// exit, so no connection is refused during a deploy.
+//
+// With --unix <path> the server listens on that Unix domain socket instead
+// of TCP (for a reverse proxy on the same host). Workers then share the
+// one socket rather than each having their own.
+
+typedef void (*WorkerMain)(const Args &args, int listen_fd);
+
+int open_listener(const Args &args);
+std::string listener_name(const Args &args);
+std::vector<int> take_over_listeners(const std::string &path);
+int supervise(const Args &args, std::vector<int> fds, WorkerMain worker);
+
+#endif
@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __MAP_H__
+#define __MAP_H__
+
+#include <map>
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "names.h"
+
+// Games whose map (and map_id) are kept between requests.
+#define KH_MAP_GAMES 1024
+
+// Static map of one game: star systems are regions with dense ids
+// (0..size()-1, ordered by hex id) and warplines are transit links, stored
+// as a CSR adjacency list.
+//
+// Maps are templates (map_id) that many games share read-only; a game with
+// rows in system_overlays gets its own copy with those applied.
+class GameMap
+{
+  public:
+    int map_id = 0;
+    uint64_t overlay = 0; // hash of the overlay applied; 0 for a template
+    std::vector<std::string> names;  // region -> system name
+    std::vector<std::string> hexes;  // region -> hex id
+    std::vector<char> base_owner;    // region -> 'A', 'B' or 0
+    std::vector<int> adj_off;        // region -> first entry in adj
+    std::vector<int> adj;            // neighbour regions
+    std::vector<int> bases[2];       // base regions owned by A / B
+    std::map<std::string, int> by_name;
+    std::map<std::string, int> by_hex;
+
+  public:
+    int size() const
+    {
+        return (int)names.size();
+    }
+
+    int region_of_name(const std::string &name) const
+    {
+        auto it = by_name.find(name);
+        return (it == by_name.end()) ? -1 : it->second;
+    }
+
+    int region_of_hex(const std::string &hex) const
+    {
+        auto it = by_hex.find(hex);
+        return (it == by_hex.end()) ? -1 : it->second;
+    }
+
+    const int *neighbors_begin(int region) const
+    {
+        return adj.data() + adj_off[region];
+    }
+
+    const int *neighbors_end(int region) const
+    {
+        return adj.data() + adj_off[region + 1];
+    }
+
+    int degree(int region) const
+    {
+        return adj_off[region + 1] - adj_off[region];
+    }
+};
+
+struct MapSystemRow
+{
+    std::string hex;
+    std::string name;
+    bool is_base;
+    char base_owner;
+};
+
+// Board geometry, for drawing a map rather than playing on it: every hex
+// with its axial coordinates, and every warpline with the hexes it crosses.
+struct MapHex
+{
+    std::string hex;
+    int q;
+    int r;
+};
+
+struct MapWarpline
+{
+    int id;
+    std::string a_hex;
+    std::string b_hex;
+    std::vector<std::string> path;
+};
+
+struct MapGeometry
+{
+    std::vector<MapHex> hexes;
+    std::vector<MapWarpline> warplines;
+};
+
+GameMap build_map(const std::vector<MapSystemRow> &systems,
+                  const std::vector<std::pair<std::string, std::string>> &links);
+typedef std::shared_ptr<const GameMap> MapPtr;
+typedef std::shared_ptr<const MapGeometry> GeometryPtr;
+
+MapPtr map_template(Db *db, int map_id);
+GeometryPtr map_template_geometry(Db *db, int map_id);
+// Case-insensitive index of the template's system names.
+NameIndexPtr map_system_names(Db *db, int map_id);
+// The template a game plays on; throws if there is no such game.
+int game_map_id(Db *db, int game_id);
+// The map 'game_id' plays on, at 'version' of the game; the overlay of a
+// negative (unknown) version is always read afresh.
+MapPtr game_map(Db *db, int game_id, int version);
+GeometryPtr game_map_geometry(Db *db, int game_id);
+GameMap load_map_csv(const std::string &dir, int map_id);
+MapGeometry load_map_geometry_csv(const std::string &dir, int map_id);
+uint64_t map_fingerprint(const GameMap &m);
+
+#endif
@@ -0,0 +1,147 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __MAPPACK_H__
+#define __MAPPACK_H__
+
+#include <stdint.h>
+#include <string>
+
+#include "map.h"
+
+// Map pack: one map template compiled offline (kh-mapc) from the seed CSVs
+// into a checksummed file that kh reads at startup (--map-pack). It is
+// decoded once, before any worker is forked, and games on that template
+// then use the decoded map instead of the star_systems / warplines / hexes
+// rows; workers start out sharing its pages copy-on-write.
+//
+// The file is the header followed by sections at the offsets it gives, each
+// 8-byte aligned, in host byte order. Nothing in it is a pointer, so it
+// reads the same wherever it is loaded. Strings are NUL-terminated in the
+// string table and referenced by offset into it.
+
+#define KH_MP_MAGIC "KHMP0002"
+#define KH_MP_FORMAT 2
+
+struct MapPackHeader
+{
+    char magic[8];
+    uint32_t format;   // KH_MP_FORMAT
+    uint32_t map_id;   // template the pack was built from
+    uint64_t map_hash; // map_fingerprint() of the map
+    uint64_t checksum; // FNV-1a of everything after the header
+    uint64_t size;     // of the whole file
+
+    uint32_t regions;
+    uint32_t adj_count;
+    uint32_t hexes;
+    uint32_t warplines;
+    uint32_t path_count;
+    uint32_t strings_size;
+
+    uint64_t off_regions;   // MapPackRegion[regions], in region order
+    uint64_t off_adj_off;   // uint32_t[regions + 1] (CSR offsets)
+    uint64_t off_adj;       // uint32_t[adj_count] (CSR neighbours)
+    uint64_t off_hexes;     // MapPackHex[hexes], by hex id
+    uint64_t off_warplines; // MapPackWarpline[warplines]
+    uint64_t off_path;      // uint32_t[path_count]: hex id strings
+    uint64_t off_strings;   // char[strings_size]
+};
+
+struct MapPackRegion
+{
+    uint32_t name;
+    uint32_t hex;
+    uint8_t base_owner; // 'A', 'B' or 0
+    uint8_t reserved[7];
+};
+
+struct MapPackHex
+{
+    uint32_t hex;
+    int32_t q;
+    int32_t r;
+};
+
+struct MapPackWarpline
+{
+    int32_t id;
+    uint32_t a_hex;
+    uint32_t b_hex;
+    uint32_t path_off; // into the path section
+    uint32_t path_len;
+};
+
+class MapPack
+{
+  public:
+    MapPack();
+
+    void open(const std::string &path);
+    bool loaded() const
+    {
+        return is_loaded;
+    }
+    const MapPackHeader &header() const
+    {
+        return hdr;
+    }
+    // Decoded once at open().
+    const GameMap &map() const
+    {
+        return game_map;
+    }
+    const MapGeometry &geometry() const
+    {
+        return geo;
+    }
+
+  private:
+    MapPack(const MapPack &);
+    MapPack &operator=(const MapPack &);
+
+    const char *str(uint32_t off) const;
+    void decode();
+
+    bool is_loaded;
+    const char *base; // the file, while decode() reads it
+    MapPackHeader hdr;
+    GameMap game_map;
+    MapGeometry geo;
+};
+
+void build_map_pack(const GameMap &m, const MapGeometry &g, int map_id,
+                    const std::string &path);
+
+MapPack &shared_map_pack();
+
+#endif
@@ -0,0 +1,111 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __MAPVIEW_H__
+#define __MAPVIEW_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "map.h"
+#include "snapshot.h"
+#include "spatial.h"
+#include "typs.h"
+
+// Half the height of a board hex (and the row step), in board units.
+#define KH_HEX_HALF_H 34.6410161514
+
+// A map serialized in each format, with the ETag naming its content, and
+// indexed by position for viewport queries and tiles. One is built per
+// template (and per distinct overlay) on first request and kept; games on
+// the same map share it.
+class MapDoc
+{
+  public:
+    std::string etag;
+    bool empty = false; // no map rows for the game (yet)
+    CachedBody json;
+    CachedBody cbor;
+
+    MapPtr map;      // shared with the games on the same template
+    GeometryPtr geo;
+    std::vector<int> sys_q, sys_r; // region -> coordinates, if on a hex
+    std::vector<char> sys_placed;
+    std::vector<int> sys_hex;        // region -> geo.hexes, or -1
+    std::vector<int> warp_a, warp_b; // warpline -> its end hexes, or -1
+    HexGrid hexes;     // -> geo.hexes
+    HexGrid systems;   // -> region
+    HexGrid warplines; // -> geo.warplines
+
+    // Where map_view.html draws each hex centre, and the same three
+    // indexes over those board coordinates.
+    std::vector<double> hex_x, hex_y;
+    HexGrid board_hexes = HexGrid(KH_BOARD_CELL);
+    HexGrid board_systems = HexGrid(KH_BOARD_CELL);
+    HexGrid board_warplines = HexGrid(KH_BOARD_CELL);
+
+    // The square a zoom 0 tile covers: everything drawn, from (tile_x0,
+    // tile_y0) over tile_span board units, a power of two.
+    int tile_x0 = 0, tile_y0 = 0, tile_span = 1;
+};
+
+typedef std::shared_ptr<const MapDoc> MapDocPtr;
+
+class ViewShip
+{
+  public:
+    char owner;
+    std::string code;
+    std::string name;
+    std::string type;
+    std::string seen; // turn of an enemy sighting
+    int region;
+};
+
+MapDocPtr map_doc(Db *db, int game_id);
+std::vector<ViewShip> visible_ships(Db *db, const GameMap &m,
+                                    const GameSnapshot &snap, char side);
+
+// GET /api/map[?game=<id>]: the board of a game (hexes, star systems and
+// warplines with their paths) for drawing it. Without ?game= the caller's
+// session picks the game. The body names the map, not the game, so games
+// on the same map share it.
+void handle_map(const HttpRequest *req, Db *db, HttpResponse *resp);
+
+// GET /api/view?q0=&r0=&q1=&r1=[&lod=]: the part of the caller's game that
+// lies in an axial rectangle (hexes, systems, warplines, and the ships the
+// caller can see), thinned to a coarser level of detail for large areas.
+void handle_view(const HttpRequest *req, Db *db, HttpResponse *resp);
+
+#endif
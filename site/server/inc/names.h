@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __NAMES_H__
+#define __NAMES_H__
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Case-insensitive lookup and prefix completion over a fixed set of names
+// (a map's star systems, a side's ship codes). Names are folded to ASCII
+// upper case. find() is one hash probe; complete() walks a trie over the
+// folded names in sorted order, where each node knows the run of names
+// below it, so a prefix costs its length plus the names returned.
+class NameIndex
+{
+  public:
+    NameIndex() {}
+    explicit NameIndex(const std::vector<std::string> &names);
+
+    // The name that folds to the same as 'name', or "" if there is none.
+    std::string find(const std::string &name) const;
+    // Up to 'limit' names beginning with 'prefix' (in any case), in order.
+    std::vector<std::string> complete(const std::string &prefix,
+                                      size_t limit) const;
+    size_t size() const
+    {
+        return sorted.size();
+    }
+
+  private:
+    // Children of a node are contiguous in 'nodes' and ordered by label.
+    struct Node
+    {
+        char label;
+        uint32_t child;
+        uint32_t children;
+        uint32_t lo, hi; // the names below: sorted[lo, hi)
+    };
+
+    std::vector<std::string> sorted; // as given, ordered by folded name
+    std::unordered_map<std::string, uint32_t> by_folded;
+    std::vector<Node> nodes; // nodes[0] is the root
+};
+
+typedef std::shared_ptr<const NameIndex> NameIndexPtr;
+
+std::string fold_name(const std::string &s);
+
+#endif
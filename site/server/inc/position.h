@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __POSITION_H__
+#define __POSITION_H__
+
+#include <bitset>
+#include <stdint.h>
+#include <vector>
+
+#include "map.h"
+#include "typs.h"
+
+// Compact, copyable game position for search and simulation. Unlike ShipRow
+// it holds no strings: regions are GameMap ids, ship ownership is an index,
+// and racked systemships point at their carrier instead of naming it.
+
+#define KH_MAX_REGIONS 256
+#define KH_MAX_SHIPS 128
+#define KH_NO_REGION 0xFFFF
+#define KH_NO_SHIP 0xFF
+
+typedef std::bitset<KH_MAX_REGIONS> RegionSet;
+
+// Fixed-width ship record (16 bytes). A racked ship has region KH_NO_REGION
+// and follows its carrier; an undeployed ship has neither.
+struct PackedShip
+{
+    uint16_t region;
+    uint8_t carrier;
+    uint8_t owner; // 0 = A, 1 = B
+    uint8_t type;  // 'W' or 'S'
+    uint8_t num;   // code number: W<num> / S<num>
+    uint8_t tech;
+    uint8_t PD;
+    uint8_t B;
+    uint8_t S;
+    uint8_t T;
+    uint8_t M;
+    uint8_t SR;
+    uint8_t pad[3];
+};
+
+// One ply: the side to move relocates a single warpship along one warpline
+// (its rack travels with it), or holds when ship == KH_NO_SHIP.
+struct Move
+{
+    uint8_t ship;
+    uint16_t to;
+};
+
+class Position
+{
+  public:
+    PackedShip ships[KH_MAX_SHIPS];
+    RegionSet occ[2]; // regions occupied by A / B (racked ships excluded)
+    uint16_t round;
+    uint8_t nships;
+    uint8_t to_move; // 0 = A, 1 = B
+    uint8_t vp[2];
+    uint8_t vp_need;
+    char winner; // 0 while the game is in play, else 'A' or 'B'
+
+  public:
+    Position()
+    {
+        nships = 0;
+        round = 1;
+        to_move = 0;
+        vp[0] = vp[1] = 0;
+        vp_need = 1;
+        winner = 0;
+    }
+
+    int region_of(int i) const
+    {
+        const PackedShip &s = ships[i];
+        if (s.carrier != KH_NO_SHIP)
+            return ships[s.carrier].region;
+        return s.region;
+    }
+
+    int add_ship(const PackedShip &s);
+    void remove_ships_at(int region);
+    void refresh_occupancy(int side, int region);
+};
+
+Position position_from_rows(const GameMap &m, const GameState &s,
+                            const std::vector<ShipRow> &shipsA,
+                            const std::vector<ShipRow> &shipsB);
+void position_to_rows(const GameMap &m, const Position &p,
+                      std::vector<ShipRow> &shipsA,
+                      std::vector<ShipRow> &shipsB);
+
+void generate_moves(const GameMap &m, const Position &p,
+                    std::vector<Move> &out);
+void make_move(const GameMap &m, Position &p, const Move &mv);
+uint64_t perft(const GameMap &m, const Position &p, int depth);
+
+#endif
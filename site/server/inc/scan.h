@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __SCAN_H__
+#define __SCAN_H__
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "map.h"
+#include "snapshot.h"
+#include "typs.h"
+
+// Scan coverage: a side observes enemy ships (not racked) in every system
+// where it has a ship of its own, and in every system one warpline away.
+//
+// Per game, coverage counts and the visible set are kept in memory and
+// updated as ships move; only changed sightings are written back, in one
+// batched upsert per player-turn. A state dropped mid-turn hands what its
+// committed commands saw to the next one loaded, and a draining worker
+// writes out whatever is still pending.
+
+class Sighting
+{
+  public:
+    std::string code;
+    std::string name;
+    char type;
+    std::string at_system;
+    std::string last_seen_turn;
+    bool in_view;
+
+  public:
+    Sighting()
+    {
+        type = 'W';
+        in_view = false;
+    }
+};
+
+class ScanState
+{
+  public:
+    class Tracked
+    {
+      public:
+        std::string name;
+        char type;
+        int region; // -1 when racked or undeployed
+    };
+
+    bool loaded = false;
+    int version = -1; // game version this matches; -1 until committed
+    MapPtr map; // shared with other games on the same template
+    std::map<std::string, Tracked> ships[2];
+    std::vector<std::set<std::string>> at[2]; // region -> ship codes
+    std::vector<int> cover[2];                // region -> observers in range
+    std::map<std::string, Sighting> seen[2];  // observer -> subject code
+    std::set<std::string> dirty[2];
+    // As of 'version': its turn, and the dirty sightings then.
+    std::string turn;
+    std::map<std::string, Sighting> committed[2];
+
+  public:
+    void load(Db *db, int game_id);
+    void move(int owner, const std::string &code, int region);
+    void remove(int owner, const std::string &code);
+
+  private:
+    void observe(int observer, const std::string &code);
+    void cover_area(int owner, int region, int delta);
+};
+
+void scan_note_location(Db *db, int game_id, char owner,
+                        const std::string &code, const std::string &at_system);
+void scan_note_removed(Db *db, int game_id, char owner,
+                       const std::string &code);
+void scan_reset(Db *db, int game_id);
+void scan_forget(int game_id);
+void scan_begin(int game_id, int version);
+void scan_commit(Db *db, int game_id, int version, const std::string &turn);
+SeenShipsPtr scan_seen(int game_id, int side);
+void scan_flush(Db *db, int game_id, const std::string &turn);
+bool scan_pending();
+void scan_flush_all(Db *db);
+std::string scan_report(Db *db, int game_id, char observer);
+
+#endif
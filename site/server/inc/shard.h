@@ -0,0 +1,188 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __SHARD_H__
+#define __SHARD_H__
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <semaphore.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "db.h"
+#include "typs.h"
+
+// Game-sharded request execution.
+//
+// Each game has a home shard (game_id % shards). A shard is a single thread
+// with its own database connection that runs every command for its games
+// one at a time, so game state never needs a lock. Requests arrive whole
+// from the worker's intake loop (intake.h) and are spread round-robin over
+// the shards; the shard that admits one looks up the caller's game and
+// forwards it to the home shard's mailbox when it is not the home shard
+// itself. State and event reads stay where they are and are served from
+// the game's snapshot (snapshot.h).
+//
+// Admission control: each shard has one bounded queue per request class
+// and always serves commands first, then admits new requests, then state
+// polls, then event history. A request that finds its queue full is shed
+// with 503 and Retry-After; a token that exceeds its rate gets 429.
+
+#define KH_CLASS_COMMAND 0 // commands, login, logout
+#define KH_CLASS_INTAKE 1  // read, not routed yet
+#define KH_CLASS_STATE 2
+#define KH_CLASS_EVENTS 3 // event history, static files
+#define KH_CLASSES 4
+
+#define KH_BUCKET_STRIPES 64
+
+class ShardPool;
+
+class ShardJob
+{
+  public:
+    ShardJob(int fd_, const HttpRequest &req_)
+        : next(NULL), fd(fd_), game(-1), req(req_)
+    {
+    }
+
+    std::atomic<ShardJob *> next;
+    int fd;
+    int game; // -1 until the request has been admitted
+    HttpRequest req;
+};
+
+// Intrusive multi-producer single-consumer queue (Vyukov). push() is
+// wait-free and may be called from any thread; pop() only from the owner.
+class Mailbox
+{
+  public:
+    Mailbox();
+
+    void push(ShardJob *j);
+    ShardJob *pop();
+
+  private:
+    Mailbox(const Mailbox &);
+    Mailbox &operator=(const Mailbox &);
+
+    std::atomic<ShardJob *> head;
+    ShardJob *tail;
+    ShardJob stub;
+};
+
+class Shard
+{
+  public:
+    Shard(ShardPool *pool_, int index_);
+    ~Shard();
+
+    void start(const Args &args);
+    bool post(ShardJob *j, int cls);
+
+  private:
+    Shard(const Shard &);
+    Shard &operator=(const Shard &);
+
+    void run();
+    void admit(ShardJob *j);
+    void handle(ShardJob *j);
+    int game_for(const HttpRequest &req);
+
+    ShardPool *pool;
+    int index;
+    Mailbox box[KH_CLASSES];
+    std::atomic<int> depth[KH_CLASSES];
+    sem_t wake;
+    Db db;
+    std::map<std::string, int> token_game;
+    std::thread th;
+};
+
+// Per-token rate limits: 'rate' requests a second, bursts up to 'burst'.
+// Buckets are striped by token hash, each stripe under its own mutex.
+class TokenBuckets
+{
+  public:
+    TokenBuckets();
+
+    void configure(double rate_, double burst_);
+    bool take(const std::string &token, int &retry_after);
+
+  private:
+    struct Bucket
+    {
+        double tokens;
+        double stamp; // seconds, steady clock
+    };
+    struct Stripe
+    {
+        std::mutex mu;
+        std::map<std::string, Bucket> b;
+    };
+
+    double rate;
+    double burst;
+    Stripe stripes[KH_BUCKET_STRIPES];
+};
+
+class ShardPool
+{
+  public:
+    ShardPool();
+    ~ShardPool();
+
+    void start(int n, const Args &args);
+    void submit(int fd, const HttpRequest &req);
+    Shard &home(int game_id);
+    bool allow(const std::string &token, int &retry_after);
+    void release(ShardJob *j);
+    bool drain(int seconds);
+    int size() const
+    {
+        return (int)shards.size();
+    }
+
+  private:
+    ShardPool(const ShardPool &);
+    ShardPool &operator=(const ShardPool &);
+
+    std::vector<Shard *> shards;
+    std::atomic<unsigned> rr;
+    std::atomic<int> inflight;
+    TokenBuckets buckets;
+};
+
+#endif
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "db.h"
+#include "typs.h"
+
+// Read-side view of a game: an immutable, reference-counted snapshot of the
+// state and its recent events, published by the game's home shard after
+// each command and swapped in atomically. Readers on any thread take a
+// reference and serialize from it without locking the game; a snapshot
+// stays valid for as long as someone holds it.
+
+#define KH_EVENT_RING 256       // recent events held in memory per game
+#define KH_SNAPSHOT_HISTORY 32 // earlier versions kept for deltas
+
+class EventRow
+{
+  public:
+    int seq;
+    std::string cmd;
+    std::string result;
+    std::string ts;
+};
+
+typedef std::shared_ptr<const EventRow> EventPtr;
+
+// The most recent events of a game by seq. Appended to by the home shard
+// only; readers on other threads see either the event they ask for or
+// NULL once it has been overwritten.
+class EventRing
+{
+  public:
+    void push(const EventRow &e);
+    EventPtr at(int seq) const;
+
+  private:
+    EventPtr slot[KH_EVENT_RING];
+};
+
+// A serialized response body and the ETag it was served under.
+class CachedBody
+{
+  public:
+    std::string etag;
+    std::string content_type;
+    std::string body;
+};
+
+typedef std::shared_ptr<const CachedBody> CachedBodyPtr;
+
+// An enemy ship as one side last saw it.
+class SeenShip
+{
+  public:
+    std::string code;
+    std::string name;
+    std::string type;
+    std::string at_system;
+    std::string seen; // turn it was last seen in
+};
+
+typedef std::shared_ptr<const std::vector<SeenShip>> SeenShipsPtr;
+
+class GameSnapshot
+{
+  public:
+    GameState state;
+    std::shared_ptr<EventRing> events; // shared with later snapshots
+    int last_seq = 0;                  // newest event this snapshot covers
+    std::vector<GameState> history; // earlier versions, oldest first
+
+    // /api/state bodies for viewers A and B, filled on first read and
+    // dropped with the snapshot at the next save. Use atomic_load/store.
+    mutable CachedBodyPtr state_body[2];
+
+    // Enemy ships A and B have seen as of this version, set from the scan
+    // state by the home shard before it publishes; NULL in a snapshot built
+    // anywhere else, whose readers fall back to the sightings table. Use
+    // atomic_load/store.
+    mutable SeenShipsPtr seen[2];
+};
+
+typedef std::shared_ptr<const GameSnapshot> SnapshotPtr;
+
+SnapshotPtr build_snapshot(Db *db, int game_id,
+                           const SnapshotPtr &prev = SnapshotPtr());
+void publish_snapshot(int game_id, const SnapshotPtr &snap);
+SnapshotPtr current_snapshot(int game_id);
+void snapshot_check_versions(bool on);
+SnapshotPtr game_snapshot(Db *db, int game_id);
+const GameState *snapshot_version(const GameSnapshot &snap, int version);
+
+#endif
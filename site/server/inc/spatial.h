@@ -0,0 +1,73 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __SPATIAL_H__
+#define __SPATIAL_H__
+
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over axial (q, r) hex coordinates. Items are ints (indexes
+// into the caller's tables) with a bounding box; each grid cell (of
+// KH_GRID_CELL x KH_GRID_CELL hexes by default) lists the items whose box
+// overlaps it, so a rectangle query only visits the cells it covers.
+
+#define KH_GRID_CELL 16
+#define KH_BOARD_CELL 256 // for board (drawing) coordinates
+
+class HexGrid
+{
+  public:
+    explicit HexGrid(int cell = KH_GRID_CELL) : cell(cell) {}
+    void insert(int item, int q0, int r0, int q1, int r1);
+    // Items whose box overlaps [q0,q1] x [r0,r1], ascending, each once.
+    std::vector<int> query(int q0, int r0, int q1, int r1) const;
+    int size() const
+    {
+        return (int)boxes.size();
+    }
+
+  private:
+    struct Box
+    {
+        int item, q0, r0, q1, r1;
+    };
+    static long long key(int cq, int cr);
+    int cell_of(int v) const;
+
+    int cell;
+    std::vector<Box> boxes;
+    std::unordered_map<long long, std::vector<int>> cells; // -> boxes
+    int min_q = 0, min_r = 0, max_q = -1, max_r = -1;
+};
+
+#endif
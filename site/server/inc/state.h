@@ -38,8 +38,8 @@
 #include "db.h"
 #include "typs.h"
 
-std::string json_ok_with_state_and_event(const GameState &s,
-                                         const std::string &eventText);
+void reply_state_and_event(const HttpRequest *req, HttpResponse *resp,
+                           const GameState &s, const std::string &eventText);
 void handle_state(const HttpRequest *req, Db *db, HttpResponse *resp);
 
 #endif
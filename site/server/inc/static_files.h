@@ -0,0 +1,68 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __STATIC_FILES_H__
+#define __STATIC_FILES_H__
+
+#include <string>
+
+#include "typs.h"
+
+// Optional static file server for the web client (--static <dir>), so a
+// small deployment needs no proxy in front of kh.
+//
+// Files under the mount prefix (default /kh/, matching the client's
+// <base href>) are sent with sendfile() and a strong ETag/Last-Modified.
+// Requests carrying a version (?v=...) are cached for a year; others are
+// revalidated. A precompressed sibling (name.br, name.gz) is sent instead
+// when the client accepts that encoding. The API is also answered under
+// the prefix (/kh/api/... is /api/...).
+
+class StaticFiles
+{
+  public:
+    void open(const std::string &dir, const std::string &prefix);
+    bool enabled() const
+    {
+        return !root.empty();
+    }
+    void map_api(HttpRequest &req) const;
+    bool serve(const HttpRequest *req, HttpResponse *resp) const;
+
+  private:
+    std::string root;
+    std::string mount; // always ends in '/'
+};
+
+StaticFiles &static_files();
+
+#endif
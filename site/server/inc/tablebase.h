@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __TABLEBASE_H__
+#define __TABLEBASE_H__
+
+#include <stdint.h>
+#include <string>
+
+#include "map.h"
+#include "position.h"
+
+// Endgame tablebase: win/draw/loss with distance (in plies) for every
+// placement of up to max_a / max_b warpships on a map, built offline by
+// retrograde analysis and probed through a read-only mmap.
+//
+// Tables cover "sudden death" positions, where the next VP decides the game
+// for either side (always the case in the learning scenario).
+
+#define KH_TB_MAGIC "KHTB0001"
+#define KH_TB_MAX_SHIPS 2
+
+#define KH_TB_DRAW 0
+#define KH_TB_WIN 1
+#define KH_TB_LOSS 2
+#define KH_TB_UNUSED 3
+
+struct TablebaseHeader
+{
+    char magic[8];
+    uint64_t map_hash;
+    uint32_t regions;
+    uint32_t max_a;
+    uint32_t max_b;
+    uint32_t reserved;
+    uint64_t entries;
+};
+
+// Result from the side to move's point of view.
+struct TbResult
+{
+    int wdl;      // KH_TB_WIN, KH_TB_DRAW or KH_TB_LOSS
+    int distance; // plies until the game ends (0 for draws)
+};
+
+class Tablebase
+{
+  public:
+    Tablebase();
+    ~Tablebase();
+
+    void open(const std::string &path);
+    bool loaded() const
+    {
+        return hdr != NULL;
+    }
+    bool matches(const GameMap &m) const;
+    bool probe(const GameMap &m, const Position &p, TbResult &out) const;
+    bool best_move(const GameMap &m, const Position &p, Move &mv,
+                   TbResult &out) const;
+
+  private:
+    Tablebase(const Tablebase &);
+    Tablebase &operator=(const Tablebase &);
+
+    void *base;
+    size_t len;
+    const TablebaseHeader *hdr;
+    const uint16_t *entries;
+};
+
+void build_tablebase(const GameMap &m, int max_a, int max_b, int threads,
+                     const std::string &path);
+
+Tablebase &endgame_tablebase();
+
+#endif
@@ -0,0 +1,57 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#ifndef __TILES_H__
+#define __TILES_H__
+
+#include "db.h"
+#include "typs.h"
+
+// GET /api/tile?z=&x=&y=: an SVG tile of the caller's game map, drawn as
+// map_view.html draws it plus the caller's view of the fleets. The zoom 0
+// tile is the square around the whole board (MapDoc::tile_span board units,
+// a power of two); at zoom z a tile covers tile_span >> z units, down to
+// KH_TILE_MIN_SPAN, and tile (x, y) starts x and y of those from the
+// board's corner. Star names show on tiles of up to 2048 units, hex
+// outlines on tiles of up to 1024.
+//
+// Rendered tiles are kept in an LRU of KH_TILE_CACHE entries. An entry is
+// keyed by game, side and position, and remembers a hash of what was drawn
+// into it; a new game version only re-renders tiles whose fleets changed.
+
+#define KH_TILE_MIN_SPAN 128
+#define KH_TILE_PIXELS 256
+#define KH_TILE_CACHE 4096
+
+void handle_tile(const HttpRequest *req, Db *db, HttpResponse *resp);
+
+#endif
@@ -34,11 +34,15 @@
 #define __TYPS_H__
 
 #include <algorithm>
+#include <cstddef>
 #include <map>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "encode.h"
 #include "json.h"
 
 // Kepler's Horizon phase sequencing: VP count is implicit at start-of-turn;
@@ -56,6 +60,7 @@ typedef struct
 {
     std::string method;
     std::string path;
+    std::string query; // text after '?', if any
     std::map<std::string, std::string> headers;
     std::string body;
 } HttpRequest;
@@ -64,13 +69,19 @@ typedef struct
 {
     int status = 200;
     std::string content_type = "application/json";
+    std::string etag; // sent with "Cache-Control: no-cache" when set
+    int retry_after = 0; // seconds; sent as Retry-After when set
+    std::map<std::string, std::string> headers; // any others
     std::string body;
+    int file_fd = -1;       // if open, sent with sendfile() instead of body
+    long long file_size = 0;
 } HttpResponse;
 
 class GameState
 {
   public:
     int game_id;
+    int version = 0;      // bumped by every save_game
     std::string scenario; // "", "learning","basic","advanced"
     int round;
     std::string active_player;
@@ -143,7 +154,7 @@ class GameState
         if (phase_index == PH_MOVEMENT)
             return "Movement (not implemented). Use 'next' to continue.";
         if (phase_index == PH_RESOLVE_COMBAT)
-            return "Combat (not implemented). Use 'next' to continue.";
+            return "Combat resolved. Use 'next' to continue.";
         if (phase_index == PH_SYSTEM_PICKDROP)
             return "SystemShip shuffle (not implemented). Use 'next' to continue.";
         if (phase_index == PH_END_TURN)
@@ -151,21 +162,58 @@ class GameState
         return "";
     }
 
+    // Writes the state as an object. With 'from', only the members that
+    // differ from it are written; applying them member by member to 'from'
+    // gives this state.
+    void encode(Encoder &e, const GameState *from = NULL) const
+    {
+        auto num = [&](const char *k, int v, int was) {
+            if (!from || v != was)
+            {
+                e.key(k);
+                e.num(v);
+            }
+        };
+        auto str = [&](const char *k, const std::string &v,
+                       const std::string &was) {
+            if (!from || v != was)
+            {
+                e.key(k);
+                e.str(v);
+            }
+        };
+        auto ab = [&](const char *k, int a, int b, int wasA, int wasB) {
+            if (!from || a != wasA || b != wasB)
+            {
+                e.key(k);
+                e.begin_object();
+                e.key("A");
+                e.num(a);
+                e.key("B");
+                e.num(b);
+                e.end_object();
+            }
+        };
+        const GameState &f = from ? *from : *this;
+        e.begin_object();
+        num("gameId", game_id, f.game_id);
+        num("version", version, f.version);
+        str("scenario", scenario, f.scenario);
+        num("round", round, f.round);
+        str("activePlayer", active_player, f.active_player);
+        num("phaseIndex", phase_index, f.phase_index);
+        str("phase", phase_name(), f.phase_name());
+        ab("vp", vpA, vpB, f.vpA, f.vpB);
+        ab("bp", bpA, bpB, f.bpA, f.bpB);
+        str("notes", notes(), f.notes());
+        e.end_object();
+    }
+
     std::string to_json() const
     {
-        std::ostringstream o;
-        o << "{";
-        o << "\"gameId\":" << game_id << ",";
-        o << "\"scenario\":\"" << json_escape(scenario) << "\",";
-        o << "\"round\":" << round << ",";
-        o << "\"activePlayer\":\"" << active_player << "\",";
-        o << "\"phaseIndex\":" << phase_index << ",";
-        o << "\"phase\":\"" << json_escape(phase_name()) << "\",";
-        o << "\"vp\":{\"A\":" << vpA << ",\"B\":" << vpB << "},";
-        o << "\"bp\":{\"A\":" << bpA << ",\"B\":" << bpB << "},";
-        o << "\"notes\":\"" << json_escape(notes()) << "\"";
-        o << "}";
-        return o.str();
+        JsonEncoder e;
+        encode(e);
+        return e.out;
     }
 
     static GameState from_json_min(const std::string &js)
@@ -298,6 +346,16 @@ class Args
         dbname = "dbname";
         listen = "127.0.0.1";
         port = 8080;
+        tablebase = "";
+        map_pack = "";
+        shards = 0;
+        rate = 20;
+        workers = 1;
+        handoff = "";
+        takeover = "";
+        unix_path = "";
+        static_dir = "";
+        static_prefix = "/kh/";
     }
 
   public:
@@ -307,6 +365,16 @@ class Args
     std::string dbname;
     std::string listen;
     int port;
+    std::string tablebase;
+    std::string map_pack; // mmap'd map for all games (kh-mapc)
+    int shards; // 0 = one per core
+    int rate;   // requests/second per session token; 0 = unlimited
+    int workers;          // processes sharing the port (SO_REUSEPORT)
+    std::string handoff;  // unix socket offering our listeners to a successor
+    std::string takeover; // unix socket of the server we replace
+    std::string unix_path; // listen here instead of --listen/--port
+    std::string static_dir;    // serve the web client from here, if set
+    std::string static_prefix; // URL path it is served under
 };
 
 #endif
@@ -53,6 +53,38 @@ Args parse_args(int argc, char **argv)
             next(a.dbname);
         else if (k == "--listen")
             next(a.listen);
+        else if (k == "--tablebase")
+            next(a.tablebase);
+        else if (k == "--map-pack")
+            next(a.map_pack);
+        else if (k == "--static")
+            next(a.static_dir);
+        else if (k == "--static-prefix")
+            next(a.static_prefix);
+        else if (k == "--unix")
+            next(a.unix_path);
+        else if (k == "--handoff")
+            next(a.handoff);
+        else if (k == "--takeover")
+            next(a.takeover);
+        else if (k == "--workers")
+        {
+            std::string t;
+            next(t);
+            a.workers = std::atoi(t.c_str());
+        }
+        else if (k == "--rate")
+        {
+            std::string t;
+            next(t);
+            a.rate = std::atoi(t.c_str());
+        }
+        else if (k == "--shards")
+        {
+            std::string t;
+            next(t);
+            a.shards = std::atoi(t.c_str());
+        }
         else if (k == "--port")
         {
             std::string t;
@@ -31,11 +31,18 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /////////////////////////////////////////////////////////////////////////////////
 #include "app.h"
+#include "combat.h"
 #include "comms.h"
 #include "db.h"
 #include "events.h"
+#include "fleet.h"
 #include "game.h"
+#include "map.h"
+#include "position.h"
+#include "scan.h"
+#include "snapshot.h"
 #include "state.h"
+#include "tablebase.h"
 #include "typs.h"
 #include "util.h"
 
@@ -50,66 +57,32 @@ static std::string upper_ascii(const std::string &s)
 
 static std::string resolve_system_hex(Db *db, int game_id, const std::string &canon_name)
 {
-    std::ostringstream q;
-    q << "SELECT hex_id FROM star_systems WHERE game_id=" << game_id
-      << " AND name='" << db->esc(canon_name) << "' LIMIT 1";
-    auto r = db->query(q.str());
-    if (r.empty()) {
-        return "";
-    }
-    return r[0][0];
+    MapPtr m = map_template(db, game_map_id(db, game_id));
+    int region = m->region_of_name(canon_name);
+    return region < 0 ? "" : m->hexes[region];
 }
 
 static std::string resolve_system_name(Db *db, int game_id,
                                        const std::string &user_supplied)
 {
-    std::string u = upper_ascii(user_supplied);
-    auto r = db->query("SELECT name FROM star_systems WHERE game_id=" +
-                       std::to_string(game_id) + " AND UPPER(name)='" +
-                       db->esc(u) + "' LIMIT 1");
-    if (!r.empty() && !r[0].empty())
-        return r[0][0];
-    return u;
-}
-
-static bool system_exists(Db *db, int game_id, const std::string &user_supplied)
-{
-    std::string u = upper_ascii(user_supplied);
-    auto r = db->query("SELECT name FROM star_systems WHERE game_id=" +
-                       std::to_string(game_id) + " AND UPPER(name)='" +
-                       db->esc(u) + "' LIMIT 1");
-    return !r.empty();
+    std::string name =
+        map_system_names(db, game_map_id(db, game_id))->find(user_supplied);
+    return name.empty() ? upper_ascii(user_supplied) : name;
 }
 
 #include <iostream>
 #include <unordered_map>
 #include <queue>
 
-void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
-{
-    if (req->method != "POST")
-    {
-        resp->status = 405;
-        resp->body = json_error("method");
-        return;
-    }
-    AuthContext a = require_auth(db, (const HttpRequest *)req, resp);
-    if (resp->status != 200)
-    {
-        return;
-    }
-    std::string cmdline = trim(json_get_string(req->body, "command"));
-
-    //debug std::cout << "Command: " << cmdline.c_str() << std::endl;
+#define KH_COMMAND_ATTEMPTS 5
 
-    if (cmdline.empty())
-    {
-        resp->status = 400;
-        resp->body = json_error("empty command");
-        return;
-    }
- 
+// One attempt at a command; save_game throws VersionConflict if the game
+// moved on since it was loaded.
+static void run_command(const HttpRequest *req, Db *db, const AuthContext &a,
+                        const std::string &cmdline, HttpResponse *resp)
+{
     GameState s = load_game(db, a.game_id);
+    scan_begin(a.game_id, s.version);
 
     std::vector<std::string> tok = split_ws(cmdline);
     std::string cmd = to_lower(tok[0]);
@@ -178,40 +151,36 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
     };
 
     auto list_fleet_text = [&](char whichOwner) -> std::string {
-        auto ships = load_ships(db, a.game_id, whichOwner);
+        Fleet fleet = load_fleet(db, a.game_id, whichOwner);
         std::ostringstream o;
         o << (whichOwner == me ? "Blue-force fleet:" : "Red-force fleet:")
           << "\n";
-        if (ships.empty())
+        if (fleet.ships.empty())
         {
             o << "  (none)\n";
             return o.str();
         }
-        for (auto &sh : ships)
+        for (size_t i = 0; i < fleet.ships.size(); i++)
         {
+            const ShipRow &sh = fleet.ships[i];
             o << "  " << sh.name << " - " << sh.code << " (L" << sh.attr.tech
               << ") "
               << fmt_attrs(sh.attr.PD, sh.attr.B, sh.attr.S, sh.attr.T,
                            sh.attr.M, sh.attr.SR);
             if (!sh.racked_in.empty())
                 o << " [RACKED in " << sh.racked_in << "]";
-            else if (!sh.at_system.empty())
-                o << " @ " << sh.at_system;
-            else
+            if (!fleet.location((int)i).empty())
+                o << " @ " << fleet.location((int)i);
+            else if (sh.racked_in.empty())
                 o << " @ (undeployed)";
             if (sh.attr.type == 'W' && sh.attr.SR > 0)
             {
-                int cnt = count_racked_in(db, a.game_id, whichOwner, sh.code);
-                if (cnt > 0)
+                const std::vector<int> &carried = fleet.cargo((int)i);
+                if (!carried.empty())
                 {
-                    auto carried = db->query(
-                        "SELECT ship_code FROM ships WHERE game_id=" +
-                        std::to_string(a.game_id) + " AND owner='" +
-                        std::string(1, whichOwner) + "' AND racked_in='" +
-                        db->esc(sh.code) + "' ORDER BY ship_code");
                     o << " carrying:";
-                    for (auto &c : carried)
-                        o << " " << c[0];
+                    for (auto c : carried)
+                        o << " " << fleet.ships[c].code;
                 }
                 else
                 {
@@ -249,6 +218,7 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
                  std::to_string(a.game_id));
         set_current_draft(db, a.game_id, 'A', "");
         set_current_draft(db, a.game_id, 'B', "");
+        scan_reset(db, a.game_id);
         eventText = "Game reset. Type: start learning|basic|advanced";
     }
     else if (cmd == "start")
@@ -266,8 +236,10 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
                 resp->body = json_error("unknown scenario");
                 return;
             }
+            int version = s.version;
             s = new_game_state_for_scenario(sc);
             s.game_id = a.game_id;
+            s.version = version;
 
             // Clear per-game DB state
             db->exec("DELETE FROM drafts WHERE game_id=" +
@@ -276,6 +248,7 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
                      std::to_string(a.game_id));
             set_current_draft(db, a.game_id, 'A', "");
             set_current_draft(db, a.game_id, 'B', "");
+            scan_reset(db, a.game_id);
 
             eventText = "Game started: " + sc + ". " + s.notes();
         }
@@ -286,7 +259,7 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
             // eventText set by require_my_turn
             save_game(db, s);
             append_event(db, a.game_id, a.user_id, cmdline, eventText, s);
-            resp->body = json_ok_with_state_and_event(s, eventText);
+            reply_state_and_event(req, resp, s, eventText);
             return;
         }
         std::string before = s.phase_name();
@@ -294,12 +267,16 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
         int beforeRound = s.round;
 
         advance_next(db, s);
+        if (s.active_player != beforeP)
+            scan_flush(db, a.game_id, turnToken);
 
         std::ostringstream msg;
         msg << "Advanced: " << beforeP << " / " << before << " -> "
             << s.active_player << " / " << s.phase_name();
         if (s.round != beforeRound)
             msg << " (round " << s.round << ")";
+        if (s.phase_index == PH_RESOLVE_COMBAT)
+            msg << "\n" << resolve_combat(db, s);
         eventText = msg.str();
     }
     else if (cmd == "list")
@@ -360,9 +337,7 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
             }
             else if (sub == "scan")
             {
-                eventText =
-                    "list scan: not implemented yet (sightings table is "
-                    "present for later).";
+                eventText = scan_report(db, a.game_id, owner);
             }
             else
             {
@@ -812,6 +787,7 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
                 {
                     std::string hex = resolve_system_hex(db, a.game_id, sys);
                     update_ship_location(db, a.game_id, owner, code, sys, hex, "");
+                    scan_note_location(db, a.game_id, owner, code, sys);
                     eventText =
                         "Deployed " + sh.name + " - " + sh.code + " to " + sys;
                 }
@@ -832,19 +808,22 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
         {
             std::string wcode = tok[1];
             std::string scode = tok[2];
+            Fleet fleet = load_fleet(db, a.game_id, owner);
+            int wi = fleet.find(wcode);
+            int si = fleet.find(scode);
 
-            if (!ship_exists(db, a.game_id, owner, wcode))
+            if (wi < 0)
             {
                 eventText = "Warpship not found: " + wcode;
             }
-            else if (!ship_exists(db, a.game_id, owner, scode))
+            else if (si < 0)
             {
                 eventText = "Systemship not found: " + scode;
             }
             else
             {
-                ShipRow w = load_ship(db, a.game_id, owner, wcode);
-                ShipRow sship = load_ship(db, a.game_id, owner, scode);
+                const ShipRow &w = fleet.ships[wi];
+                const ShipRow &sship = fleet.ships[si];
                 if (w.attr.type != 'W')
                 {
                     eventText = "Not a Warpship: " + wcode;
@@ -862,26 +841,26 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
                 }
                 else if (cmd == "pickup")
                 {
-                    if (w.at_system.empty() || sship.at_system.empty())
+                    const std::string &wat = fleet.location(wi);
+                    const std::string &sat = fleet.location(si);
+                    if (!sship.racked_in.empty())
                     {
-                        eventText = "Both ships must be deployed to the same "
-                                    "system first.";
+                        eventText =
+                            "Systemship already racked in " + sship.racked_in;
                     }
-                    else if (w.at_system != sship.at_system)
+                    else if (wat.empty() || sat.empty())
                     {
-                        eventText = "Not co-located: " + wcode + "@" +
-                                    w.at_system + " vs " + scode + "@" +
-                                    sship.at_system;
+                        eventText = "Both ships must be deployed to the same "
+                                    "system first.";
                     }
-                    else if (!sship.racked_in.empty())
+                    else if (wat != sat)
                     {
-                        eventText =
-                            "Systemship already racked in " + sship.racked_in;
+                        eventText = "Not co-located: " + wcode + "@" + wat +
+                                    " vs " + scode + "@" + sat;
                     }
                     else
                     {
-                        int carried =
-                            count_racked_in(db, a.game_id, owner, w.code);
+                        int carried = (int)fleet.cargo(wi).size();
                         if (carried >= w.attr.SR)
                         {
                             std::ostringstream o;
@@ -892,7 +871,9 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
                         else
                         {
                             update_ship_location(db, a.game_id, owner, scode,
-                                                 "", w.at_hex, wcode);
+                                                 "", "", wcode);
+                            scan_note_location(db, a.game_id, owner, scode,
+                                               "");
                             eventText = "Picked up " + sship.name + " - " +
                                         sship.code + " into " + w.name + " - " +
                                         w.code;
@@ -916,6 +897,8 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
                         {
                             update_ship_location(db, a.game_id, owner, scode,
                                                  w.at_system, w.at_hex, "");
+                            scan_note_location(db, a.game_id, owner, scode,
+                                               w.at_system);
                             eventText = "Dropped " + sship.name + " - " +
                                         sship.code + " at " + w.at_system;
                         }
@@ -924,6 +907,49 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
             }
         }
     }
+    else if (cmd == "eval")
+    {
+        Tablebase &tb = endgame_tablebase();
+        if (s.scenario.empty())
+        {
+            eventText = "No scenario. Type: start learning|basic|advanced";
+        }
+        else if (!tb.loaded())
+        {
+            eventText = "No endgame tablebase loaded.";
+        }
+        else
+        {
+            MapPtr mp = game_map(db, a.game_id, s.version);
+            const GameMap &m = *mp;
+            Position p = position_from_rows(m, s, load_ships(db, a.game_id, 'A'),
+                                            load_ships(db, a.game_id, 'B'));
+            Move mv;
+            TbResult r;
+            if (!tb.best_move(m, p, mv, r))
+            {
+                eventText = "Position is not covered by the endgame tablebase.";
+            }
+            else
+            {
+                std::ostringstream o;
+                o << "Endgame: " << active << " to move ";
+                if (r.wdl == KH_TB_WIN)
+                    o << "wins in " << r.distance << " plies.";
+                else if (r.wdl == KH_TB_LOSS)
+                    o << "loses in " << r.distance << " plies.";
+                else
+                    o << "draws.";
+                if (mv.ship == KH_NO_SHIP)
+                    o << " Best: hold.";
+                else
+                    o << " Best: " << (char)p.ships[mv.ship].type
+                      << (int)p.ships[mv.ship].num << " to " << m.names[mv.to]
+                      << ".";
+                eventText = o.str();
+            }
+        }
+    }
     else
     {
         resp->status = 400;
@@ -934,6 +960,75 @@ void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
     save_game(db, s);
     append_event(db, a.game_id, a.user_id, cmdline, eventText, s);
 
-    resp->body = json_ok_with_state_and_event(s, eventText);
+    reply_state_and_event(req, resp, s, eventText);
     return;
 }
+
+void handle_usr_command(const HttpRequest *req, Db *db, HttpResponse *resp)
+{
+    if (req->method != "POST")
+    {
+        resp->status = 405;
+        resp->body = json_error("method");
+        return;
+    }
+    AuthContext a = require_auth(db, (const HttpRequest *)req, resp);
+    if (resp->status != 200)
+    {
+        return;
+    }
+    std::string cmdline = trim(body_field(req, "command"));
+
+    //debug std::cout << "Command: " << cmdline.c_str() << std::endl;
+
+    if (cmdline.empty())
+    {
+        resp->status = 400;
+        resp->body = json_error("empty command");
+        return;
+    }
+
+    // Each attempt runs in a transaction that only commits if save_game's
+    // version check passes. On a conflict all of its writes are rolled back
+    // and the command re-runs against the newer state.
+    for (int attempt = 1;; attempt++)
+    {
+        db->exec("START TRANSACTION");
+        try
+        {
+            run_command(req, db, a, cmdline, resp);
+            db->exec("COMMIT");
+            SnapshotPtr snap = build_snapshot(db, a.game_id,
+                                              current_snapshot(a.game_id));
+            const GameState &cs = snap->state;
+            scan_commit(db, a.game_id, cs.version,
+                        "R" + std::to_string(cs.round) +
+                            (cs.active_player.empty() ? 'A'
+                                                      : cs.active_player[0]));
+            for (int sd = 0; sd < 2; sd++)
+                std::atomic_store(&snap->seen[sd], scan_seen(a.game_id, sd));
+            publish_snapshot(a.game_id, snap);
+            return;
+        }
+        catch (const VersionConflict &)
+        {
+            db->exec("ROLLBACK");
+            scan_forget(a.game_id);
+        }
+        catch (...)
+        {
+            db->exec("ROLLBACK");
+            scan_forget(a.game_id);
+            throw;
+        }
+
+        resp->status = 200;
+        resp->body.clear();
+        if (attempt >= KH_COMMAND_ATTEMPTS)
+        {
+            resp->status = 409;
+            resp->body = json_error("game changed concurrently; try again");
+            return;
+        }
+    }
+}
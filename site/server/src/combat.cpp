@@ -0,0 +1,127 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "combat.h"
+
+#include "app.h"
+#include "game.h"
+#include "scan.h"
+
+int CombatBatch::add(int engagement_id, int side_index)
+{
+    engagement.push_back(engagement_id);
+    side.push_back(side_index);
+    return size() - 1;
+}
+
+void CombatBatch::resolve()
+{
+    int n = size();
+    destroyed.assign(n, 0);
+
+    // An engagement with both sides present is a conflict; all of it goes.
+    for (int lo = 0; lo < n;)
+    {
+        int hi = lo;
+        bool present[2] = {false, false};
+        while (hi < n && engagement[hi] == engagement[lo])
+            present[side[hi++]] = true;
+        for (int i = lo; i < hi; i++)
+            destroyed[i] = (present[0] && present[1]) ? 1 : 0;
+        lo = hi;
+    }
+}
+
+// Resolves every contested system of the game in one batch and persists
+// the losses. Returns a report for the event log.
+std::string resolve_combat(Db *db, GameState &s)
+{
+    std::vector<ShipRow> fleets[2] = {load_ships(db, s.game_id, 'A'),
+                                      load_ships(db, s.game_id, 'B')};
+
+    std::map<std::string, int> present[2];
+    for (int sd = 0; sd < 2; sd++)
+    {
+        for (auto &sh : fleets[sd])
+        {
+            if (sh.racked_in.empty() && !sh.at_system.empty())
+                present[sd][sh.at_system]++;
+        }
+    }
+
+    std::vector<std::string> systems;
+    for (auto &kv : present[0])
+    {
+        if (present[1].count(kv.first))
+            systems.push_back(kv.first);
+    }
+    if (systems.empty())
+        return "No contested systems.";
+
+    CombatBatch batch;
+    std::vector<std::pair<int, ShipRow *>> units;
+    for (size_t e = 0; e < systems.size(); e++)
+    {
+        for (int sd = 0; sd < 2; sd++)
+        {
+            for (auto &sh : fleets[sd])
+            {
+                if (sh.racked_in.empty() && sh.at_system == systems[e])
+                {
+                    batch.add((int)e, sd);
+                    units.push_back(std::make_pair(sd, &sh));
+                }
+            }
+        }
+    }
+    batch.resolve();
+
+    std::ostringstream o;
+    int cur = -1;
+    for (int i = 0; i < batch.size(); i++)
+    {
+        char owner = units[i].first ? 'B' : 'A';
+        ShipRow &sh = *units[i].second;
+        if (batch.engagement[i] != cur)
+        {
+            cur = batch.engagement[i];
+            o << (cur ? "\n" : "") << "Combat at " << systems[cur] << ":";
+        }
+        if (batch.destroyed[i])
+        {
+            delete_ship(db, s.game_id, owner, sh.code);
+            scan_note_removed(db, s.game_id, owner, sh.code);
+            o << " " << owner << " " << sh.code << " destroyed;";
+        }
+    }
+    return o.str();
+}
@@ -34,11 +34,20 @@
 
 #include "app.h"
 #include "cmd.h"
+#include "complete.h"
+#include "compress.h"
 #include "db.h"
 #include "events.h"
+#include "mapview.h"
 #include "state.h"
+#include "static_files.h"
+#include "tiles.h"
 #include "util.h"
 
+#include <chrono>
+#include <sys/sendfile.h>
+#include <sys/time.h>
+
 void dispatch_request(const HttpRequest *req, Db *db, HttpResponse *resp)
 {
     if (req->path == "/api/login")
@@ -67,6 +76,30 @@ void dispatch_request(const HttpRequest *req, Db *db, HttpResponse *resp)
         handle_events(req, db, resp);
         return;
     }
+    else if (req->path == "/api/map")
+    {
+        handle_map(req, db, resp);
+        return;
+    }
+    else if (req->path == "/api/view")
+    {
+        handle_view(req, db, resp);
+        return;
+    }
+    else if (req->path == "/api/tile")
+    {
+        handle_tile(req, db, resp);
+        return;
+    }
+    else if (req->path == "/api/complete")
+    {
+        handle_complete(req, db, resp);
+        return;
+    }
+    else if (static_files().serve(req, resp))
+    {
+        return;
+    }
     else
     {
         resp->status = 404;
@@ -83,6 +116,8 @@ std::string status_text(int code)
         return "OK";
     case 201:
         return "Created";
+    case 304:
+        return "Not Modified";
     case 400:
         return "Bad Request";
     case 401:
@@ -91,10 +126,18 @@ std::string status_text(int code)
         return "Not Found";
     case 405:
         return "Method Not Allowed";
+    case 409:
+        return "Conflict";
+    case 413:
+        return "Payload Too Large";
+    case 429:
+        return "Too Many Requests";
     case 500:
         return "Internal Server Error";
     case 502:
         return "Bad Gateway";
+    case 503:
+        return "Service Unavailable";
     default:
         return "OK";
     }
@@ -105,50 +148,48 @@ std::string http_serialize(const HttpResponse &r)
     std::ostringstream o;
     o << "HTTP/1.1 " << r.status << " " << status_text(r.status) << "\r\n";
     o << "Content-Type: " << r.content_type << "\r\n";
-    o << "Content-Length: " << r.body.size() << "\r\n";
+    o << "Content-Length: "
+      << (r.file_fd >= 0 ? (unsigned long long)r.file_size
+                         : (unsigned long long)r.body.size())
+      << "\r\n";
     o << "Connection: close\r\n";
-    o << "Cache-Control: no-store\r\n";
+    if (!r.etag.empty())
+        o << "ETag: " << r.etag << "\r\n";
+    if (r.headers.find("Cache-Control") == r.headers.end())
+        o << "Cache-Control: " << (r.etag.empty() ? "no-store" : "no-cache")
+          << "\r\n";
+    if (r.retry_after > 0)
+        o << "Retry-After: " << r.retry_after << "\r\n";
+    for (auto &h : r.headers)
+        o << h.first << ": " << h.second << "\r\n";
     o << "\r\n";
     o << r.body;
     return o.str();
 }
 
-HttpRequest http_parse(int fd)
+// Whether 'data' holds a whole request: its headers and as much body as
+// their Content-Length announces.
+bool http_complete(const std::string &data)
 {
-    std::string data;
-    data.reserve(8192);
+    size_t header_end = data.find("\r\n\r\n");
+    if (header_end == std::string::npos)
+        return false;
 
-    char buf[4096];
-    ssize_t n;
-    while ((n = ::recv(fd, buf, sizeof(buf), 0)) > 0)
+    // crude Content-Length support
+    std::string head = to_lower(data.substr(0, header_end + 2));
+    size_t content_len = 0;
+    size_t clpos = head.find("content-length:");
+    if (clpos != std::string::npos)
     {
-        data.append(buf, buf + n);
-        // stop if we have headers and full body
-        size_t header_end = data.find("\r\n\r\n");
-        if (header_end != std::string::npos)
-        {
-            // crude Content-Length support
-            size_t clpos = to_lower(data).find("content-length:");
-            size_t content_len = 0;
-            if (clpos != std::string::npos)
-            {
-                size_t line_end = data.find("\r\n", clpos);
-                std::string line = data.substr(clpos, line_end - clpos);
-                size_t colon = line.find(':');
-                if (colon != std::string::npos)
-                {
-                    content_len = static_cast<size_t>(
-                        std::atoi(trim(line.substr(colon + 1)).c_str()));
-                }
-            }
-            size_t body_start = header_end + 4;
-            if (data.size() >= body_start + content_len)
-                break;
-        }
-        if (data.size() > 1024 * 1024)
-            break; // safety
+        size_t line_end = head.find("\r\n", clpos);
+        content_len = static_cast<size_t>(std::atoi(
+            trim(head.substr(clpos + 15, line_end - clpos - 15)).c_str()));
     }
+    return data.size() >= header_end + 4 + content_len;
+}
 
+HttpRequest http_parse(const std::string &data)
+{
     HttpRequest req;
     size_t line_end = data.find("\r\n");
     if (line_end == std::string::npos)
@@ -159,6 +200,12 @@ HttpRequest http_parse(int fd)
         std::istringstream is(request_line);
         is >> req.method >> req.path;
     }
+    size_t qmark = req.path.find('?');
+    if (qmark != std::string::npos)
+    {
+        req.query = req.path.substr(qmark + 1);
+        req.path.resize(qmark);
+    }
 
     size_t header_end = data.find("\r\n\r\n");
     if (header_end == std::string::npos)
@@ -189,6 +236,75 @@ HttpRequest http_parse(int fd)
     return req;
 }
 
+// Tags the response with 'etag'; if the client already holds it
+// (If-None-Match), turns the response into a bodiless 304 and returns true.
+bool not_modified(const HttpRequest *req, HttpResponse *resp,
+                  const std::string &etag)
+{
+    resp->etag = etag;
+    auto it = req->headers.find("if-none-match");
+    if (it == req->headers.end())
+        return false;
+
+    std::istringstream is(it->second);
+    std::string t;
+    while (std::getline(is, t, ','))
+    {
+        t = trim(t);
+        if (starts_with(t, "W/"))
+            t = t.substr(2);
+        // Tags of compressed bodies name their encoding (compress.h).
+        static const char *enc[] = {"-gzip\"", "-deflate\""};
+        for (size_t i = 0; i < 2; i++)
+        {
+            std::string e = enc[i];
+            if (t.size() > e.size() &&
+                t.compare(t.size() - e.size(), e.size(), e) == 0)
+                t = t.substr(0, t.size() - e.size()) + "\"";
+        }
+        if (t == etag || t == "*")
+        {
+            resp->status = 304;
+            resp->body.clear();
+            return true;
+        }
+    }
+    return false;
+}
+
+// Clients that list application/cbor in Accept get CBOR payloads, everyone
+// else JSON. Error bodies (json_error) stay JSON either way.
+bool wants_cbor(const HttpRequest *req)
+{
+    auto it = req->headers.find("accept");
+    return it != req->headers.end() &&
+           to_lower(it->second).find("application/cbor") != std::string::npos;
+}
+
+std::unique_ptr<Encoder> response_encoder(const HttpRequest *req)
+{
+    if (wants_cbor(req))
+        return std::unique_ptr<Encoder>(new CborEncoder());
+    return std::unique_ptr<Encoder>(new JsonEncoder());
+}
+
+void set_body(HttpResponse *resp, Encoder &e)
+{
+    resp->content_type = e.content_type();
+    resp->body.swap(e.out);
+}
+
+// String member 'key' of a request body sent as CBOR (by Content-Type) or
+// JSON.
+std::string body_field(const HttpRequest *req, const std::string &key)
+{
+    auto it = req->headers.find("content-type");
+    if (it != req->headers.end() &&
+        starts_with(to_lower(it->second), "application/cbor"))
+        return cbor_get_string(req->body, key);
+    return json_get_string(req->body, key);
+}
+
 std::string pick_bearer(const HttpRequest *req)
 {
     auto it = req->headers.find("authorization");
@@ -238,26 +354,130 @@ AuthContext require_auth(Db *db, const HttpRequest *req, HttpResponse *resp)
     db->exec("UPDATE sessions SET last_seen=NOW() WHERE token='" +
              db->esc(tok) + "'");
 
-    // Ensure a current game exists (single shared game for now)
-    auto g = db->query(
-        "SELECT id,state_json,scenario FROM games ORDER BY id DESC LIMIT 1");
+    a.game_id = session_game(db, tok);
+    return a;
+}
+
+int create_game(Db *db)
+{
+    GameState s;
+    s.create_empty_game();
+
+    std::string state = s.to_json();
+    std::string ins = "INSERT INTO games(scenario,state_json) VALUES(NULL,'" +
+                      db->esc(state) + "')";
+    db->exec(ins);
+    auto r = db->query("SELECT LAST_INSERT_ID()");
+    return std::atoi(r[0][0].c_str());
+}
+
+// The game a session plays in. Sessions from before multi-game hosting
+// carry no game; they are pinned to the newest game (created if needed).
+// Returns 0 for unknown tokens.
+int session_game(Db *db, const std::string &token)
+{
+    auto rows = db->query("SELECT game_id FROM sessions WHERE token='" +
+                          db->esc(token) + "'");
+    if (rows.empty())
+        return 0;
+    if (!rows[0][0].empty())
+        return std::atoi(rows[0][0].c_str());
+
+    int game_id = 0;
+    auto g = db->query("SELECT id FROM games ORDER BY id DESC LIMIT 1");
     if (g.empty())
+        game_id = create_game(db);
+    else
+        game_id = std::atoi(g[0][0].c_str());
+    db->exec("UPDATE sessions SET game_id=" + std::to_string(game_id) +
+             " WHERE token='" + db->esc(token) + "'");
+    return game_id;
+}
+
+void serve_request(int fd, const HttpRequest &req, Db *db)
+{
+    HttpResponse resp;
+
+    try
     {
-        // create default empty game
-        GameState s;
-        s.create_empty_game();
-
-        std::string state = s.to_json();
-        std::string ins =
-            "INSERT INTO games(scenario,state_json) VALUES(NULL,'" +
-            db->esc(state) + "')";
-        db->exec(ins);
-        auto r = db->query("SELECT LAST_INSERT_ID()");
-        a.game_id = std::atoi(r[0][0].c_str());
+        dispatch_request(&req, db, &resp);
     }
-    else
+    catch (const std::exception &e)
     {
-        a.game_id = std::atoi(g[0][0].c_str());
+        resp.status = 500;
+        resp.body = json_error(std::string("server error: ") + e.what());
     }
-    return a;
+
+    compress_response(&req, &resp);
+    send_response(fd, resp);
+}
+
+// Lets the next send on 'fd' block until 'deadline' at most; false once it
+// has passed.
+static bool send_budget(int fd, std::chrono::steady_clock::time_point deadline)
+{
+    long long left = std::chrono::duration_cast<std::chrono::microseconds>(
+                         deadline - std::chrono::steady_clock::now())
+                         .count();
+    if (left <= 0)
+        return false;
+    struct timeval tv;
+    tv.tv_sec = (time_t)(left / 1000000);
+    tv.tv_usec = (suseconds_t)(left % 1000000);
+    ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    return true;
+}
+
+void send_response(int fd, const HttpResponse &resp)
+{
+    std::string out = http_serialize(resp);
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() +
+        std::chrono::seconds(KH_SEND_TIMEOUT);
+    int more = MSG_NOSIGNAL | (resp.file_fd >= 0 ? MSG_MORE : 0);
+    bool ok = true;
+    size_t done = 0;
+    while (ok && done < out.size())
+    {
+        ok = send_budget(fd, deadline);
+        ssize_t n = ok ? ::send(fd, out.data() + done, out.size() - done,
+                                more)
+                       : 0;
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            ok = false;
+        else
+            done += (size_t)n;
+    }
+    if (resp.file_fd >= 0)
+    {
+        // sendfile() has no MSG_NOSIGNAL; main() ignores SIGPIPE, so a
+        // client that hangs up shows here as EPIPE or ECONNRESET and the
+        // rest of the file is simply dropped. The send timeout applies to
+        // each piece sendfile() moves, so it is called a piece at a time
+        // to keep to the deadline.
+        off_t off = 0;
+        while (ok && off < (off_t)resp.file_size)
+        {
+            ok = send_budget(fd, deadline);
+            size_t piece = (size_t)std::min<off_t>(
+                resp.file_size - off, KH_SEND_PIECE);
+            ssize_t n = ok ? ::sendfile(fd, resp.file_fd, &off, piece) : 0;
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                ok = false;
+        }
+        ::close(resp.file_fd);
+    }
+    if (!ok)
+    {
+        // Reset rather than leave the kernel trickling out what is queued.
+        struct linger lg;
+        lg.l_onoff = 1;
+        lg.l_linger = 0;
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    }
+    ::close(fd);
 }
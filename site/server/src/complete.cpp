@@ -0,0 +1,171 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "complete.h"
+
+#include "app.h"
+#include "comms.h"
+#include "flight.h"
+#include "map.h"
+#include "names.h"
+#include "snapshot.h"
+#include "util.h"
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// A side's ship and draft codes as of one game version.
+class ShipCodes
+{
+  public:
+    int version = -1;
+    NameIndex index;
+};
+
+typedef std::shared_ptr<const ShipCodes> ShipCodesPtr;
+
+// The newest codes per game and side, least recently used dropped first.
+class ShipCodesCache
+{
+  public:
+    ShipCodesPtr get(const std::string &key, int version)
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = entries.find(key);
+        if (it == entries.end() || it->second.codes->version != version)
+            return ShipCodesPtr();
+        order.splice(order.begin(), order, it->second.lru);
+        return it->second.codes;
+    }
+
+    void put(const std::string &key, ShipCodesPtr codes)
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            if (it->second.codes->version < codes->version)
+                it->second.codes = codes;
+            order.splice(order.begin(), order, it->second.lru);
+            return;
+        }
+        order.push_front(key);
+        Entry e = {codes, order.begin()};
+        entries[key] = e;
+        while (entries.size() > KH_COMPLETE_CACHE)
+        {
+            entries.erase(order.back());
+            order.pop_back();
+        }
+    }
+
+  private:
+    struct Entry
+    {
+        ShipCodesPtr codes;
+        std::list<std::string>::iterator lru;
+    };
+    std::mutex mu;
+    std::list<std::string> order; // most recently used first
+    std::unordered_map<std::string, Entry> entries;
+};
+
+static ShipCodesPtr ship_codes(Db *db, int game_id, int version, char side)
+{
+    static ShipCodesCache latest; // game.side
+    static SingleFlight<ShipCodes> flight;
+
+    std::string key = std::to_string(game_id) + "." + side;
+    ShipCodesPtr c = latest.get(key, version);
+    if (c)
+        return c;
+    c = flight.run(key + "." + std::to_string(version), [&]() {
+        std::string where = " WHERE game_id=" + std::to_string(game_id) +
+                            " AND owner='" + std::string(1, side) + "'";
+        auto rows = db->query("SELECT ship_code FROM ships" + where +
+                              " UNION SELECT ship_code FROM drafts" + where);
+        std::vector<std::string> codes;
+        for (auto &r : rows)
+            codes.push_back(r[0]);
+        std::shared_ptr<ShipCodes> s = std::make_shared<ShipCodes>();
+        s->version = version;
+        s->index = NameIndex(codes);
+        return ShipCodesPtr(s);
+    });
+    latest.put(key, c);
+    return c;
+}
+
+void handle_complete(const HttpRequest *req, Db *db, HttpResponse *resp)
+{
+    if (req->method != "GET")
+    {
+        resp->status = 405;
+        resp->body = json_error("method");
+        return;
+    }
+    AuthContext a = require_auth(db, req, resp);
+    if (resp->status != 200)
+        return;
+
+    std::string prefix = query_param(req->query, "prefix");
+    int limit = KH_COMPLETE_LIMIT;
+    std::string l = query_param(req->query, "limit");
+    if (!l.empty())
+        limit = std::max(1, std::min(std::atoi(l.c_str()), KH_COMPLETE_MAX));
+
+    NameIndexPtr systems = map_system_names(db, game_map_id(db, a.game_id));
+    SnapshotPtr snap = game_snapshot(db, a.game_id);
+    char side = owner_for_username(a.username);
+    ShipCodesPtr ships = ship_codes(db, a.game_id, snap->state.version, side);
+
+    std::unique_ptr<Encoder> e = response_encoder(req);
+    e->begin_object();
+    e->key("ok");
+    e->boolean(true);
+    e->key("prefix");
+    e->str(prefix);
+    e->key("systems");
+    e->begin_array();
+    for (auto &s : systems->complete(prefix, limit))
+        e->str(s);
+    e->end_array();
+    e->key("ships");
+    e->begin_array();
+    for (auto &s : ships->index.complete(prefix, limit))
+        e->str(s);
+    e->end_array();
+    e->end_object();
+    resp->headers["Vary"] = "Accept";
+    set_body(resp, *e);
+}
@@ -0,0 +1,179 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "compress.h"
+
+#include "app.h"
+#include "util.h"
+
+#include <zlib.h>
+
+// Skip a path once its bodies shrink to more than this share of their size
+// on average; re-probe every KH_COMPRESS_PROBE skipped responses.
+#define KH_COMPRESS_WORTH 0.85
+#define KH_COMPRESS_PROBE 64
+
+#define KH_ENC_GZIP 0
+#define KH_ENC_DEFLATE 1
+
+class Deflater
+{
+  public:
+    Deflater(int window_bits)
+    {
+        std::memset(&zs, 0, sizeof(zs));
+        ok = deflateInit2(&zs, KH_COMPRESS_LEVEL, Z_DEFLATED, window_bits, 8,
+                          Z_DEFAULT_STRATEGY) == Z_OK;
+    }
+    ~Deflater()
+    {
+        if (ok)
+            deflateEnd(&zs);
+    }
+
+    bool run(const std::string &in, std::string &out)
+    {
+        if (!ok || deflateReset(&zs) != Z_OK)
+            return false;
+        out.resize(deflateBound(&zs, in.size()));
+        zs.next_in = (Bytef *)in.data();
+        zs.avail_in = (uInt)in.size();
+        zs.next_out = (Bytef *)&out[0];
+        zs.avail_out = (uInt)out.size();
+        if (deflate(&zs, Z_FINISH) != Z_STREAM_END)
+            return false;
+        out.resize(zs.total_out);
+        return true;
+    }
+
+  private:
+    Deflater(const Deflater &);
+    Deflater &operator=(const Deflater &);
+
+    z_stream zs;
+    bool ok;
+};
+
+class PathStats
+{
+  public:
+    double ratio = 0.5; // running average of compressed/raw size
+    int skipped = 0;
+};
+
+class ThreadCompressor
+{
+  public:
+    ThreadCompressor() : gzip(15 + 16), deflate(15)
+    {
+    }
+
+    Deflater gzip;
+    Deflater deflate;
+    std::map<std::string, PathStats> paths;
+};
+
+static ThreadCompressor &thread_compressor()
+{
+    static thread_local ThreadCompressor c;
+    return c;
+}
+
+// Preferred encoding the client accepts (gzip over deflate), or -1.
+static int pick_encoding(const HttpRequest *req)
+{
+    auto it = req->headers.find("accept-encoding");
+    if (it == req->headers.end())
+        return -1;
+    bool gz = false, df = false;
+    std::istringstream is(to_lower(it->second));
+    std::string t;
+    while (std::getline(is, t, ','))
+    {
+        size_t semi = t.find(';');
+        std::string name = trim(t.substr(0, semi));
+        if (semi != std::string::npos)
+        {
+            std::string q = trim(t.substr(semi + 1));
+            if (starts_with(q, "q=0") &&
+                q.find_first_of("123456789") == std::string::npos)
+                continue;
+        }
+        if (name == "gzip" || name == "x-gzip")
+            gz = true;
+        else if (name == "deflate")
+            df = true;
+    }
+    return gz ? KH_ENC_GZIP : (df ? KH_ENC_DEFLATE : -1);
+}
+
+void compress_response(const HttpRequest *req, HttpResponse *resp)
+{
+    if (resp->file_fd >= 0 || resp->body.empty() ||
+        resp->headers.count("Content-Encoding"))
+        return;
+    if (!starts_with(resp->content_type, "application/json") &&
+        !starts_with(resp->content_type, "application/cbor") &&
+        !starts_with(resp->content_type, "text/") &&
+        !starts_with(resp->content_type, "image/svg"))
+        return;
+
+    std::string &vary = resp->headers["Vary"];
+    vary += vary.empty() ? "Accept-Encoding" : ", Accept-Encoding";
+    if (resp->body.size() < KH_COMPRESS_MIN)
+        return;
+    int enc = pick_encoding(req);
+    if (enc < 0)
+        return;
+
+    ThreadCompressor &tc = thread_compressor();
+    PathStats &ps = tc.paths[req->path];
+    if (ps.ratio > KH_COMPRESS_WORTH && ++ps.skipped < KH_COMPRESS_PROBE)
+        return;
+    ps.skipped = 0;
+
+    std::string out;
+    Deflater &d = (enc == KH_ENC_GZIP) ? tc.gzip : tc.deflate;
+    if (!d.run(resp->body, out))
+        return;
+    double r = (double)out.size() / (double)resp->body.size();
+    ps.ratio = 0.8 * ps.ratio + 0.2 * r;
+    if (out.size() >= resp->body.size())
+        return;
+
+    const char *name = (enc == KH_ENC_GZIP) ? "gzip" : "deflate";
+    resp->body.swap(out);
+    resp->headers["Content-Encoding"] = name;
+    // A different representation needs a different tag.
+    if (resp->etag.size() >= 2)
+        resp->etag.insert(resp->etag.size() - 1, std::string("-") + name);
+}
@@ -37,8 +37,9 @@
 
 GameState load_game(Db *db, int game_id)
 {
-    auto rows = db->query("SELECT scenario,state_json FROM games WHERE id=" +
-                          std::to_string(game_id) + " LIMIT 1");
+    auto rows =
+        db->query("SELECT scenario,state_json,version FROM games WHERE id=" +
+                  std::to_string(game_id) + " LIMIT 1");
     if (rows.empty())
         throw std::runtime_error("game not found");
     std::string scenario = rows[0][0];
@@ -47,6 +48,7 @@ GameState load_game(Db *db, int game_id)
     // state_json already includes scenario; trust it.
     GameState s = GameState::from_json_min(state_json);
     s.game_id = game_id;
+    s.version = std::atoi(rows[0][2].c_str());
 
     // safer: extract scenario/activePlayer/phaseIndex/round/bp/vp from the
     // authoritative stored JSON is omitted. We'll keep a minimal local parse +
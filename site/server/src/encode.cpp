@@ -0,0 +1,331 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "encode.h"
+
+#include "app.h"
+#include "json.h"
+
+void JsonEncoder::value()
+{
+    if (keyed)
+        keyed = false;
+    else if (!first.empty())
+    {
+        if (!first.back())
+            out += ',';
+        first.back() = false;
+    }
+}
+
+void JsonEncoder::begin_object()
+{
+    value();
+    out += '{';
+    first.push_back(true);
+}
+
+void JsonEncoder::end_object()
+{
+    out += '}';
+    first.pop_back();
+}
+
+void JsonEncoder::begin_array()
+{
+    value();
+    out += '[';
+    first.push_back(true);
+}
+
+void JsonEncoder::end_array()
+{
+    out += ']';
+    first.pop_back();
+}
+
+void JsonEncoder::key(const std::string &k)
+{
+    value();
+    out += '"';
+    out += json_escape(k);
+    out += "\":";
+    keyed = true;
+}
+
+void JsonEncoder::str(const std::string &v)
+{
+    value();
+    out += '"';
+    out += json_escape(v);
+    out += '"';
+}
+
+void JsonEncoder::num(long long v)
+{
+    value();
+    out += std::to_string(v);
+}
+
+void JsonEncoder::boolean(bool v)
+{
+    value();
+    out += v ? "true" : "false";
+}
+
+// Major type in the top three bits, then the argument in the shortest form.
+void CborEncoder::head(int major, unsigned long long v)
+{
+    unsigned char m = (unsigned char)(major << 5);
+    int n;
+    if (v < 24)
+    {
+        out += (char)(m | v);
+        return;
+    }
+    if (v <= 0xff)
+    {
+        out += (char)(m | 24);
+        n = 1;
+    }
+    else if (v <= 0xffff)
+    {
+        out += (char)(m | 25);
+        n = 2;
+    }
+    else if (v <= 0xffffffffULL)
+    {
+        out += (char)(m | 26);
+        n = 4;
+    }
+    else
+    {
+        out += (char)(m | 27);
+        n = 8;
+    }
+    for (int i = n - 1; i >= 0; i--)
+        out += (char)((v >> (8 * i)) & 0xff);
+}
+
+void CborEncoder::begin_object()
+{
+    out += (char)0xbf;
+}
+
+void CborEncoder::end_object()
+{
+    out += (char)0xff;
+}
+
+void CborEncoder::begin_array()
+{
+    out += (char)0x9f;
+}
+
+void CborEncoder::end_array()
+{
+    out += (char)0xff;
+}
+
+void CborEncoder::key(const std::string &k)
+{
+    str(k);
+}
+
+void CborEncoder::str(const std::string &v)
+{
+    head(3, v.size());
+    out += v;
+}
+
+void CborEncoder::num(long long v)
+{
+    if (v >= 0)
+        head(0, (unsigned long long)v);
+    else
+        head(1, (unsigned long long)(-(v + 1)));
+}
+
+void CborEncoder::boolean(bool v)
+{
+    out += (char)(v ? 0xf5 : 0xf4);
+}
+
+// Reads the head of the item at 'p': major type and argument, with
+// *indefinite set for the 0x1f forms. False on truncated or reserved input.
+static bool cbor_head(const std::string &b, size_t &p, int *major,
+                      unsigned long long *arg, bool *indefinite)
+{
+    if (p >= b.size())
+        return false;
+    unsigned char c = (unsigned char)b[p++];
+    *major = c >> 5;
+    *indefinite = false;
+    int info = c & 0x1f;
+    if (info < 24)
+    {
+        *arg = info;
+        return true;
+    }
+    if (info == 31)
+    {
+        *indefinite = true;
+        *arg = 0;
+        return *major >= 2 && *major != 6;
+    }
+    if (info > 27)
+        return false;
+    int n = 1 << (info - 24);
+    if (b.size() - p < (size_t)n)
+        return false;
+    *arg = 0;
+    for (int i = 0; i < n; i++)
+        *arg = (*arg << 8) | (unsigned char)b[p++];
+    return true;
+}
+
+static bool cbor_at_break(const std::string &b, size_t p)
+{
+    return p < b.size() && (unsigned char)b[p] == 0xff;
+}
+
+// Text or byte string at 'p' (definite or chunked) into *s.
+static bool cbor_string(const std::string &b, size_t &p, int major,
+                        unsigned long long arg, bool indefinite,
+                        std::string *s)
+{
+    if (!indefinite)
+    {
+        if (b.size() - p < arg)
+            return false;
+        if (s)
+            s->append(b, p, (size_t)arg);
+        p += (size_t)arg;
+        return true;
+    }
+    while (!cbor_at_break(b, p))
+    {
+        int m;
+        unsigned long long a;
+        bool ind;
+        if (!cbor_head(b, p, &m, &a, &ind) || m != major || ind ||
+            !cbor_string(b, p, m, a, false, s))
+            return false;
+    }
+    p++;
+    return true;
+}
+
+// Steps over one item, nested ones included. 'depth' bounds the nesting a
+// hostile body can make us recurse through.
+static bool cbor_skip(const std::string &b, size_t &p, int depth)
+{
+    int major;
+    unsigned long long arg;
+    bool indefinite;
+    if (depth > 16 || !cbor_head(b, p, &major, &arg, &indefinite))
+        return false;
+    switch (major)
+    {
+    case 2:
+    case 3:
+        return cbor_string(b, p, major, arg, indefinite, NULL);
+    case 4:
+    case 5:
+    {
+        int per = (major == 5) ? 2 : 1;
+        if (indefinite)
+        {
+            while (!cbor_at_break(b, p))
+                for (int i = 0; i < per; i++)
+                    if (!cbor_skip(b, p, depth + 1))
+                        return false;
+            p++;
+            return true;
+        }
+        if (arg > b.size())
+            return false;
+        for (unsigned long long n = 0; n < arg * per; n++)
+            if (!cbor_skip(b, p, depth + 1))
+                return false;
+        return true;
+    }
+    case 6:
+        return cbor_skip(b, p, depth + 1);
+    default:
+        return true;
+    }
+}
+
+std::string cbor_get_string(const std::string &body, const std::string &key)
+{
+    size_t p = 0;
+    int major;
+    unsigned long long count;
+    bool indefinite;
+    if (!cbor_head(body, p, &major, &count, &indefinite) || major != 5)
+        return "";
+    for (unsigned long long n = 0; indefinite || n < count; n++)
+    {
+        if (indefinite && cbor_at_break(body, p))
+            break;
+        size_t at = p;
+        std::string k;
+        int m;
+        unsigned long long a;
+        bool ind;
+        if (!cbor_head(body, p, &m, &a, &ind))
+            return "";
+        if (m == 3)
+        {
+            if (!cbor_string(body, p, m, a, ind, &k))
+                return "";
+        }
+        else
+        {
+            p = at;
+            if (!cbor_skip(body, p, 0))
+                return "";
+        }
+
+        at = p;
+        if (k == key && cbor_head(body, p, &m, &a, &ind) && m == 3)
+        {
+            std::string v;
+            return cbor_string(body, p, m, a, ind, &v) ? v : "";
+        }
+        p = at;
+        if (!cbor_skip(body, p, 0))
+            return "";
+    }
+    return "";
+}
@@ -35,6 +35,44 @@
 #include "db.h"
 #include "game.h"
 #include "json.h"
+#include "snapshot.h"
+#include "util.h"
+
+#define KH_EVENTS_MAX 500
+
+// Events lo..hi (by seq, ascending) from the snapshot's ring, or from the
+// database when part of the range has already left the ring.
+static std::vector<EventPtr> events_between(Db *db, const GameSnapshot &snap,
+                                            int game_id, int lo, int hi)
+{
+    std::vector<EventPtr> out;
+    for (int seq = lo; seq <= hi; seq++)
+    {
+        EventPtr e = snap.events->at(seq);
+        if (!e)
+            break;
+        out.push_back(e);
+    }
+    if (lo > hi || (int)out.size() == hi - lo + 1)
+        return out;
+
+    out.clear();
+    auto rows = db->query("SELECT seq,command_text,result_text,created_at FROM "
+                          "game_events WHERE game_id=" +
+                          std::to_string(game_id) + " AND seq BETWEEN " +
+                          std::to_string(lo) + " AND " + std::to_string(hi) +
+                          " ORDER BY seq");
+    for (auto &r : rows)
+    {
+        std::shared_ptr<EventRow> e = std::make_shared<EventRow>();
+        e->seq = std::atoi(r[0].c_str());
+        e->cmd = r[1];
+        e->result = r[2];
+        e->ts = r[3];
+        out.push_back(e);
+    }
+    return out;
+}
 
 void handle_events(const HttpRequest *req, Db *db, HttpResponse *resp)
 {
@@ -50,30 +88,73 @@ void handle_events(const HttpRequest *req, Db *db, HttpResponse *resp)
         return;
     }
 
-    // ?limit=50
+    // ?limit=50                 newest events, newest first
+    // ?since=<seq>&limit=50     events after <seq>, oldest first, with the
+    //                           cursor for the next call
     int limit = 50;
-    size_t qpos = req->path.find("?");
-    (void)qpos;
+    std::string lim = query_param(req->query, "limit");
+    if (!lim.empty())
+        limit = std::max(1, std::min(KH_EVENTS_MAX, std::atoi(lim.c_str())));
+    std::string since_arg = query_param(req->query, "since");
+    bool paged = !since_arg.empty();
+    int since = paged ? std::max(0, std::atoi(since_arg.c_str())) : 0;
 
-    auto rows =
-        db->query("SELECT seq,command_text,result_text,created_at FROM "
-                  "game_events WHERE game_id=" +
-                  std::to_string(a.game_id) + " ORDER BY seq DESC LIMIT 100");
-    std::ostringstream o;
-    o << "{\"ok\":true,\"events\":[";
+    SnapshotPtr snap = game_snapshot(db, a.game_id);
+    std::ostringstream tag;
+    tag << "\"e" << a.game_id << "." << snap->state.version << "." << limit;
+    if (paged)
+        tag << "." << since;
+    if (wants_cbor(req))
+        tag << ".c";
+    tag << "\"";
+    resp->headers["Vary"] = "Accept";
+    if (not_modified(req, resp, tag.str()))
+        return;
+
+    int lo, hi;
+    if (paged)
+    {
+        lo = since + 1;
+        hi = (snap->last_seq - since > limit) ? since + limit : snap->last_seq;
+    }
+    else
+    {
+        lo = std::max(1, snap->last_seq - limit + 1);
+        hi = snap->last_seq;
+    }
+    std::vector<EventPtr> rows = events_between(db, *snap, a.game_id, lo, hi);
+    if (!paged)
+        std::reverse(rows.begin(), rows.end());
+
+    std::unique_ptr<Encoder> e = response_encoder(req);
+    e->begin_object();
+    e->key("ok");
+    e->boolean(true);
+    if (paged)
+    {
+        e->key("next");
+        e->num(rows.empty() ? since : rows.back()->seq);
+        e->key("more");
+        e->boolean(hi < snap->last_seq);
+    }
+    e->key("events");
+    e->begin_array();
     for (size_t i = 0; i < rows.size(); ++i)
     {
-        if (i)
-            o << ",";
-        o << "{";
-        o << "\"seq\":" << rows[i][0] << ",";
-        o << "\"cmd\":\"" << json_escape(rows[i][1]) << "\",";
-        o << "\"result\":\"" << json_escape(rows[i][2]) << "\",";
-        o << "\"ts\":\"" << json_escape(rows[i][3]) << "\"";
-        o << "}";
+        e->begin_object();
+        e->key("seq");
+        e->num(rows[i]->seq);
+        e->key("cmd");
+        e->str(rows[i]->cmd);
+        e->key("result");
+        e->str(rows[i]->result);
+        e->key("ts");
+        e->str(rows[i]->ts);
+        e->end_object();
     }
-    o << "]}";
-    resp->body = o.str();
+    e->end_array();
+    e->end_object();
+    set_body(resp, *e);
     return;
 }
 
@@ -0,0 +1,65 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "fleet.h"
+
+#include "app.h"
+#include "game.h"
+
+void Fleet::build(const std::vector<ShipRow> &rows)
+{
+    ships = rows;
+    index.clear();
+    carrier.assign(ships.size(), -1);
+    rack.assign(ships.size(), std::vector<int>());
+
+    for (size_t i = 0; i < ships.size(); i++)
+        index[ships[i].code] = (int)i;
+    for (size_t i = 0; i < ships.size(); i++)
+    {
+        if (ships[i].racked_in.empty())
+            continue;
+        int c = find(ships[i].racked_in);
+        if (c < 0)
+            continue;
+        carrier[i] = c;
+        rack[c].push_back((int)i);
+    }
+}
+
+// Single query for the whole fleet, racks included.
+Fleet load_fleet(Db *db, int game_id, char owner)
+{
+    Fleet f;
+    f.build(load_ships(db, game_id, owner));
+    return f;
+}
@@ -34,6 +34,7 @@
 
 #include "app.h"
 #include "db.h"
+#include "map.h"
 
 /*
 GameState gamestate;
@@ -70,6 +71,15 @@ GameState new_game_state_for_scenario(const std::string &scenario)
     return s;
 }
 
+int vp_needed(const std::string &scenario)
+{
+    if (scenario == "learning")
+        return 1;
+    if (scenario == "basic")
+        return 2;
+    return 3;
+}
+
 void apply_start_of_turn(Db *db, GameState &s)
 {
     // Called when a player begins their player-turn (phase 0 = Build Ships).
@@ -86,16 +96,17 @@ void apply_start_of_turn(Db *db, GameState &s)
 
     int vp_gain = 0;
     {
-        std::string q =
-            "SELECT COUNT(DISTINCT ss.name) "
-            "FROM ships sh JOIN star_systems ss ON sh.at_system = ss.name "
-            "WHERE sh.game_id=" + std::to_string(s.game_id) +
-            " AND sh.owner='" + std::string(1, me) +
-            "' AND sh.racked_in IS NULL "
-            " AND ss.is_base=1 AND ss.base_owner='" + std::string(1, enemy) + "'";
-        auto r = db->query(q);
-        if (!r.empty() && !r[0].empty())
-            vp_gain = std::atoi(r[0][0].c_str());
+        MapPtr m = game_map(db, s.game_id, s.version);
+        auto r = db->query("SELECT DISTINCT at_system FROM ships WHERE game_id=" +
+                           std::to_string(s.game_id) + " AND owner='" +
+                           std::string(1, me) +
+                           "' AND racked_in IS NULL AND at_system IS NOT NULL");
+        for (auto &row : r)
+        {
+            int region = m->region_of_name(row[0]);
+            if (region >= 0 && m->base_owner[region] == enemy)
+                vp_gain++;
+        }
     }
 
     if (vp_gain > 0)
@@ -106,13 +117,7 @@ void apply_start_of_turn(Db *db, GameState &s)
             s.vpB += vp_gain;
     }
 
-    int need = 3;
-    if (s.scenario == "learning")
-        need = 1;
-    else if (s.scenario == "basic")
-        need = 2;
-    else if (s.scenario == "advanced")
-        need = 3;
+    int need = vp_needed(s.scenario);
 
     int my_vp = (me == 'A') ? s.vpA : s.vpB;
     if (my_vp >= need)
@@ -170,7 +175,9 @@ int next_event_seq(Db *db, int game_id)
     return std::atoi(r[0][0].c_str());
 }
 
-void save_game(Db *db, const GameState &s)
+// Compare-and-swap on games.version: writes only if nobody saved since 's'
+// was loaded, then advances s.version.
+void save_game(Db *db, GameState &s)
 {
     std::string q = "UPDATE games SET scenario=";
     if (s.scenario.empty())
@@ -182,10 +189,17 @@ void save_game(Db *db, const GameState &s)
         q += "'" + db->esc(s.scenario) + "'";
     }
 
-    q += ", state_json='" + db->esc(s.to_json()) +
-         "' WHERE id=" + std::to_string(s.game_id);
+    GameState next = s;
+    next.version = s.version + 1;
+    q += ", state_json='" + db->esc(next.to_json()) +
+         "', version=" + std::to_string(next.version) +
+         " WHERE id=" + std::to_string(s.game_id) +
+         " AND version=" + std::to_string(s.version);
 
     db->exec(q);
+    if (db->affected() == 0)
+        throw VersionConflict(s.game_id);
+    s.version = next.version;
 }
 
 std::string get_current_draft(Db *db, int game_id, char owner)
@@ -382,22 +396,11 @@ ShipRow load_ship(Db *db, int game_id, char owner, const std::string &code)
     s.attr.M = std::atoi(r[9].c_str());
     s.attr.SR = std::atoi(r[10].c_str());
     s.at_system = r[11];
-    s.racked_in = r[12];
+    s.at_hex = r[12];
+    s.racked_in = r[13];
     return s;
 }
 
-int count_racked_in(Db *db, int game_id, char owner,
-                    const std::string &warpship_code)
-{
-    auto rows = db->query(
-        "SELECT COUNT(*) FROM ships WHERE game_id=" + std::to_string(game_id) +
-        " AND owner='" + std::string(1, owner) + "' AND racked_in='" +
-        db->esc(warpship_code) + "'");
-    if (rows.empty())
-        return 0;
-    return std::atoi(rows[0][0].c_str());
-}
-
 void insert_ship(Db *db, int game_id, char owner, const ShipRow &s)
 {
     std::string q =
@@ -437,3 +440,11 @@ void update_ship_location(Db *db, int game_id, char owner,
         std::string(1, owner) + "' AND ship_code='" + db->esc(code) + "'";
     db->exec(q);
 }
+
+// Removes a ship and anything racked in it.
+void delete_ship(Db *db, int game_id, char owner, const std::string &code)
+{
+    db->exec("DELETE FROM ships WHERE game_id=" + std::to_string(game_id) +
+             " AND owner='" + std::string(1, owner) + "' AND (ship_code='" +
+             db->esc(code) + "' OR racked_in='" + db->esc(code) + "')");
+}
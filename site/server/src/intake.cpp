@@ -0,0 +1,190 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "intake.h"
+
+#include "app.h"
+#include "comms.h"
+#include "json.h"
+#include "shard.h"
+
+#include <chrono>
+#include <deque>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unordered_map>
+
+// A connection whose request is still arriving.
+class IntakeConn
+{
+  public:
+    unsigned long long id = 0; // tells a reused fd from the one it was
+    double deadline = 0;
+    std::string data;
+};
+
+static double now_seconds()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static void set_nonblocking(int fd, bool on)
+{
+    int fl = ::fcntl(fd, F_GETFL);
+    if (fl >= 0)
+        ::fcntl(fd, F_SETFL, on ? (fl | O_NONBLOCK) : (fl & ~O_NONBLOCK));
+}
+
+void run_intake(int srv, ShardPool &pool, volatile sig_atomic_t *stop)
+{
+    int ep = ::epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0)
+        throw std::runtime_error(std::string("epoll_create1 failed: ") +
+                                 std::strerror(errno));
+    set_nonblocking(srv, true);
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = srv;
+    ::epoll_ctl(ep, EPOLL_CTL_ADD, srv, &ev);
+
+    std::unordered_map<int, IntakeConn> conns;
+    // Deadlines are a fixed time after accept, so accept order is
+    // deadline order.
+    std::deque<std::pair<double, std::pair<int, unsigned long long>>> expiry;
+    unsigned long long next_id = 0;
+    bool accepting = true;
+
+    // Stops watching 'fd' and gives it back in blocking mode.
+    auto release = [&](int fd) {
+        ::epoll_ctl(ep, EPOLL_CTL_DEL, fd, NULL);
+        set_nonblocking(fd, false);
+        conns.erase(fd);
+    };
+
+    while (accepting || !conns.empty())
+    {
+        if (accepting && *stop)
+        {
+            ::epoll_ctl(ep, EPOLL_CTL_DEL, srv, NULL);
+            accepting = false;
+        }
+
+        epoll_event events[64];
+        int n = ::epoll_wait(ep, events, 64, 250);
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == srv)
+            {
+                int c;
+                while (accepting &&
+                       (c = ::accept4(srv, NULL, NULL,
+                                      SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+                {
+                    if (conns.size() >= KH_INTAKE_MAX_CONNS)
+                    {
+                        ::close(c);
+                        continue;
+                    }
+                    IntakeConn &conn = conns[c];
+                    conn.id = ++next_id;
+                    conn.deadline = now_seconds() + KH_INTAKE_TIMEOUT;
+                    expiry.push_back(std::make_pair(
+                        conn.deadline, std::make_pair(c, conn.id)));
+                    epoll_event cev;
+                    std::memset(&cev, 0, sizeof(cev));
+                    cev.events = EPOLLIN;
+                    cev.data.fd = c;
+                    ::epoll_ctl(ep, EPOLL_CTL_ADD, c, &cev);
+                }
+                continue;
+            }
+
+            auto it = conns.find(fd);
+            if (it == conns.end())
+                continue;
+            IntakeConn &conn = it->second;
+            bool closed = false;
+            char buf[4096];
+            while (conn.data.size() <= KH_INTAKE_MAX_REQUEST)
+            {
+                ssize_t r = ::recv(fd, buf, sizeof(buf), 0);
+                if (r > 0)
+                {
+                    conn.data.append(buf, buf + r);
+                    continue;
+                }
+                if (r < 0 && errno == EINTR)
+                    continue;
+                closed = (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK));
+                break;
+            }
+
+            if (conn.data.size() > KH_INTAKE_MAX_REQUEST)
+            {
+                release(fd);
+                HttpResponse resp;
+                resp.status = 413;
+                resp.body = json_error("request too large");
+                send_response(fd, resp);
+            }
+            else if (http_complete(conn.data))
+            {
+                HttpRequest req = http_parse(conn.data);
+                release(fd);
+                pool.submit(fd, req);
+            }
+            else if (closed)
+            {
+                release(fd);
+                ::close(fd);
+            }
+        }
+
+        double now = now_seconds();
+        while (!expiry.empty() && expiry.front().first <= now)
+        {
+            int fd = expiry.front().second.first;
+            auto it = conns.find(fd);
+            if (it != conns.end() && it->second.id == expiry.front().second.second)
+            {
+                release(fd);
+                ::close(fd);
+            }
+            expiry.pop_front();
+        }
+    }
+    ::close(ep);
+}
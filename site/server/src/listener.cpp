@@ -0,0 +1,355 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "listener.h"
+
+#include "app.h"
+#include "util.h"
+
+#include <csignal>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#define KH_MAX_LISTENERS 64
+#define KH_TAKEOVER_REQUEST 'T' // sent by a successor to ask for the listeners
+
+static sockaddr_un unix_addr(const std::string &path);
+
+// A socket file left by a previous run would make bind() fail, so remove
+// it; but only a socket that nobody accepts on any more. Anything else at
+// 'path' (a mistyped file name, a server still running) is in use.
+static void remove_stale_socket(const std::string &path)
+{
+    struct stat st;
+    if (::lstat(path.c_str(), &st) < 0)
+    {
+        if (errno == ENOENT)
+            return;
+        throw std::runtime_error("cannot stat " + path + ": " +
+                                 std::strerror(errno));
+    }
+    if (!S_ISSOCK(st.st_mode))
+        throw std::runtime_error("address in use: " + path +
+                                 " is not a socket");
+
+    int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0)
+        throw std::runtime_error("socket failed");
+    sockaddr_un addr = unix_addr(path);
+    int rc = ::connect(s, (sockaddr *)&addr, sizeof(addr));
+    int err = errno;
+    ::close(s);
+    if (rc == 0 || err != ECONNREFUSED)
+        throw std::runtime_error("address in use: " + path);
+    ::unlink(path.c_str());
+}
+
+static int open_unix_listener(const std::string &path)
+{
+    int srv = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (srv < 0)
+        throw std::runtime_error("socket failed");
+
+    remove_stale_socket(path);
+    sockaddr_un addr = unix_addr(path);
+    if (::bind(srv, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        throw std::runtime_error("bind failed: " + path + ": " +
+                                 std::strerror(errno));
+    }
+    // The proxy usually runs as another user in our group.
+    ::chmod(path.c_str(), 0660);
+    if (::listen(srv, 128) < 0)
+        throw std::runtime_error("listen failed");
+    return srv;
+}
+
+int open_listener(const Args &args)
+{
+    if (!args.unix_path.empty())
+        return open_unix_listener(args.unix_path);
+
+    int srv = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (srv < 0)
+        throw std::runtime_error("socket failed");
+
+    int one = 1;
+    setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    setsockopt(srv, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(args.port));
+    addr.sin_addr.s_addr = inet_addr(args.listen.c_str());
+
+    if (::bind(srv, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        throw std::runtime_error(std::string("bind failed: ") +
+                                 std::strerror(errno));
+    }
+    if (::listen(srv, 128) < 0)
+        throw std::runtime_error("listen failed");
+    return srv;
+}
+
+std::string listener_name(const Args &args)
+{
+    if (!args.unix_path.empty())
+        return "unix:" + args.unix_path;
+    return args.listen + ":" + std::to_string(args.port);
+}
+
+static sockaddr_un unix_addr(const std::string &path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+        throw std::runtime_error("unix socket path too long: " + path);
+    std::strcpy(addr.sun_path, path.c_str());
+    return addr;
+}
+
+static void send_fds(int sock, const std::vector<int> &fds)
+{
+    uint32_t n = (uint32_t)fds.size();
+    iovec iov;
+    iov.iov_base = &n;
+    iov.iov_len = sizeof(n);
+
+    std::vector<char> ctl(CMSG_SPACE(sizeof(int) * fds.size()));
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &ctl[0];
+    msg.msg_controllen = ctl.size();
+
+    cmsghdr *c = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type = SCM_RIGHTS;
+    c->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    std::memcpy(CMSG_DATA(c), &fds[0], sizeof(int) * fds.size());
+
+    if (::sendmsg(sock, &msg, 0) < 0)
+        throw std::runtime_error(std::string("handoff send failed: ") +
+                                 std::strerror(errno));
+}
+
+static std::vector<int> recv_fds(int sock)
+{
+    uint32_t n = 0;
+    iovec iov;
+    iov.iov_base = &n;
+    iov.iov_len = sizeof(n);
+
+    std::vector<char> ctl(CMSG_SPACE(sizeof(int) * KH_MAX_LISTENERS));
+    msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = &ctl[0];
+    msg.msg_controllen = ctl.size();
+
+    if (::recvmsg(sock, &msg, 0) <= 0)
+        throw std::runtime_error("handoff: no reply from running server");
+
+    std::vector<int> fds;
+    for (cmsghdr *c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c))
+    {
+        if (c->cmsg_level != SOL_SOCKET || c->cmsg_type != SCM_RIGHTS)
+            continue;
+        size_t k = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        fds.resize(k);
+        std::memcpy(&fds[0], CMSG_DATA(c), sizeof(int) * k);
+    }
+    if (fds.empty() || fds.size() != n)
+        throw std::runtime_error("handoff: listeners missing from reply");
+    return fds;
+}
+
+// Asks the server supervising 'path' for its listening sockets. It starts
+// draining its workers as soon as they are sent.
+std::vector<int> take_over_listeners(const std::string &path)
+{
+    int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0)
+        throw std::runtime_error("socket failed");
+    sockaddr_un addr = unix_addr(path);
+    if (::connect(s, (sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        ::close(s);
+        throw std::runtime_error("handoff: cannot reach " + path + ": " +
+                                 std::strerror(errno));
+    }
+    char req = KH_TAKEOVER_REQUEST;
+    if (::send(s, &req, 1, MSG_NOSIGNAL) != 1)
+    {
+        ::close(s);
+        throw std::runtime_error("handoff: cannot ask " + path + ": " +
+                                 std::strerror(errno));
+    }
+    std::vector<int> fds = recv_fds(s);
+    ::close(s);
+    return fds;
+}
+
+static int handoff_socket(const Args &args)
+{
+    const std::string &path = args.handoff;
+    int s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0)
+        throw std::runtime_error("socket failed");
+    // The server we took over from still holds its handoff socket while it
+    // drains, but no longer needs the name. Any other owner keeps it.
+    if (path == args.takeover)
+        ::unlink(path.c_str());
+    else
+        remove_stale_socket(path);
+    sockaddr_un addr = unix_addr(path);
+    if (::bind(s, (sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(s, 4) < 0)
+        throw std::runtime_error("handoff: cannot listen on " + path + ": " +
+                                 std::strerror(errno));
+    return s;
+}
+
+static pid_t spawn(const Args &args, const std::vector<int> &fds, size_t i,
+                   int hs, WorkerMain worker)
+{
+    pid_t pid = ::fork();
+    if (pid < 0)
+        throw std::runtime_error("fork failed");
+    if (pid == 0)
+    {
+        if (hs >= 0)
+            ::close(hs);
+        for (size_t k = 0; k < fds.size(); k++)
+            if (fds[k] != fds[i])
+                ::close(fds[k]);
+        worker(args, fds[i]);
+        ::_exit(0);
+    }
+    return pid;
+}
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_stop(int)
+{
+    stop_requested = 1;
+}
+
+// Runs the parent process until it is stopped (SIGTERM/SIGINT) or hands
+// over to a successor; in both cases its workers drain before it returns.
+int supervise(const Args &args, std::vector<int> fds, WorkerMain worker)
+{
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop;
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    int hs = args.handoff.empty() ? -1 : handoff_socket(args);
+
+    std::vector<pid_t> pids(fds.size(), 0);
+    for (size_t i = 0; i < fds.size(); i++)
+        pids[i] = spawn(args, fds, i, hs, worker);
+
+    std::fprintf(stderr, "[%s] supervising %d workers\n", now_iso().c_str(),
+                 (int)pids.size());
+
+    while (!stop_requested)
+    {
+        // Replace workers that died on their own.
+        int status;
+        pid_t dead;
+        while ((dead = ::waitpid(-1, &status, WNOHANG)) > 0)
+        {
+            for (size_t i = 0; i < pids.size(); i++)
+            {
+                if (pids[i] != dead)
+                    continue;
+                std::fprintf(stderr, "[%s] worker %d exited; restarting\n",
+                             now_iso().c_str(), (int)dead);
+                pids[i] = spawn(args, fds, i, hs, worker);
+            }
+        }
+
+        if (hs < 0)
+        {
+            ::sleep(1);
+            continue;
+        }
+        pollfd p;
+        p.fd = hs;
+        p.events = POLLIN;
+        if (::poll(&p, 1, 1000) <= 0)
+            continue;
+        int c = ::accept(hs, NULL, NULL);
+        if (c < 0)
+            continue;
+        // Only a successor that asks gets the listeners; a bare connect
+        // (another server checking whether the name is taken) does not.
+        char req = 0;
+        p.fd = c;
+        if (::poll(&p, 1, 1000) <= 0 || ::recv(c, &req, 1, 0) != 1 ||
+            req != KH_TAKEOVER_REQUEST)
+        {
+            ::close(c);
+            continue;
+        }
+        try
+        {
+            send_fds(c, fds);
+            std::fprintf(stderr, "[%s] listeners handed over; draining\n",
+                         now_iso().c_str());
+            stop_requested = 1;
+        }
+        catch (const std::exception &e)
+        {
+            std::fprintf(stderr, "[%s] %s\n", now_iso().c_str(), e.what());
+        }
+        ::close(c);
+    }
+
+    // Workers stop accepting on SIGTERM and exit once their queues drain.
+    for (size_t i = 0; i < pids.size(); i++)
+        ::kill(pids[i], SIGTERM);
+    for (size_t i = 0; i < pids.size(); i++)
+        ::waitpid(pids[i], NULL, 0);
+    if (hs >= 0)
+        ::close(hs);
+    return 0;
+}
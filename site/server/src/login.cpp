@@ -31,6 +31,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 /////////////////////////////////////////////////////////////////////////////////
 #include "app.h"
+#include "comms.h"
 #include "db.h"
 #include "json.h"
 #include "typs.h"
@@ -44,8 +45,8 @@ void handle_login(const HttpRequest *req, Db *db, HttpResponse *resp)
         resp->body = json_error("method");
         return;
     }
-    std::string u = json_get_string(req->body, "username");
-    std::string p = json_get_string(req->body, "password");
+    std::string u = body_field(req, "username");
+    std::string p = body_field(req, "password");
     if (u.empty() || p.empty())
     {
         resp->status = 400;
@@ -64,11 +65,43 @@ void handle_login(const HttpRequest *req, Db *db, HttpResponse *resp)
     }
     int user_id = std::atoi(rows[0][0].c_str());
 
+    // "game" picks the table to sit at: an id, "new", or (by default) the
+    // newest game.
+    std::string g = body_field(req, "game");
+    std::string game_sql = "NULL";
+    if (g == "new")
+        game_sql = std::to_string(create_game(db));
+    else if (!g.empty())
+    {
+        int id = std::atoi(g.c_str());
+        if (id <= 0 || db->query("SELECT id FROM games WHERE id=" +
+                                 std::to_string(id))
+                           .empty())
+        {
+            resp->status = 404;
+            resp->body = json_error("no such game");
+            return;
+        }
+        game_sql = std::to_string(id);
+    }
+
     std::string token = rand_hex_64();
-    db->exec("INSERT INTO sessions(token,user_id) VALUES('" + db->esc(token) +
-             "'," + std::to_string(user_id) + ")");
+    db->exec("INSERT INTO sessions(token,user_id,game_id) VALUES('" +
+             db->esc(token) + "'," + std::to_string(user_id) + "," + game_sql +
+             ")");
+    int game_id = session_game(db, token);
 
-    resp->body = std::string("{\"ok\":true,\"token\":\"") + token +
-                 "\",\"username\":\"" + json_escape(u) + "\"}";
+    std::unique_ptr<Encoder> e = response_encoder(req);
+    e->begin_object();
+    e->key("ok");
+    e->boolean(true);
+    e->key("token");
+    e->str(token);
+    e->key("username");
+    e->str(u);
+    e->key("game");
+    e->num(game_id);
+    e->end_object();
+    set_body(resp, *e);
     return;
 }
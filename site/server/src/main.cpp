@@ -34,12 +34,85 @@
 #include "args.h"
 #include "comms.h"
 #include "db.h"
+#include "intake.h"
+#include "listener.h"
+#include "mappack.h"
+#include "scan.h"
+#include "shard.h"
+#include "snapshot.h"
+#include "static_files.h"
+#include "tablebase.h"
 #include "util.h"
+#include <csignal>
 #include <iostream>
+#include <pthread.h>
+
+static volatile sig_atomic_t draining = 0;
+
+static void on_drain(int)
+{
+    draining = 1;
+}
+
+// One server process: the shards plus an intake loop on 'srv'. On SIGTERM
+// it stops accepting and returns once everything accepted is answered.
+static void run_worker(const Args &args, int srv)
+{
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_drain; // no SA_RESTART: epoll_wait() must return
+    sigaction(SIGTERM, &sa, NULL);
+    sigaction(SIGINT, &sa, NULL);
+
+    // Shard threads inherit this mask, so the signals reach this thread.
+    sigset_t stop, old;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGTERM);
+    sigaddset(&stop, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &stop, &old);
+    ShardPool pool;
+    pool.start(args.shards, args);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    std::fprintf(stderr,
+                 "[%s] Kepler's Horizon_server listening on %s "
+                 "(pid %d, %d shards)\n",
+                 now_iso().c_str(), listener_name(args).c_str(),
+                 (int)::getpid(), pool.size());
+
+    run_intake(srv, pool, &draining);
+
+    ::close(srv);
+    if (!pool.drain(30))
+    {
+        std::fprintf(stderr, "[%s] pid %d: gave up draining\n",
+                     now_iso().c_str(), (int)::getpid());
+        return;
+    }
+
+    // Sightings are otherwise written at turn changes; don't lose the ones
+    // seen since the last.
+    if (!scan_pending())
+        return;
+    try
+    {
+        Db db;
+        db.connect(args.dbhost, args.dbuser, args.dbpass, args.dbname);
+        scan_flush_all(&db);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "[%s] pid %d: writing sightings: %s\n",
+                     now_iso().c_str(), (int)::getpid(), e.what());
+    }
+}
 
 int main(int argc, char **argv)
 {
     std::srand(static_cast<unsigned int>(std::time(NULL)));
+    // Writes to a client that has gone away must fail, not kill us (and
+    // every game in flight); sendfile() can't ask for MSG_NOSIGNAL.
+    std::signal(SIGPIPE, SIG_IGN);
 
     Args args;
 
@@ -55,66 +128,39 @@ int main(int argc, char **argv)
 
     try
     {
-        Db db;
-        db.connect(args.dbhost, args.dbuser, args.dbpass, args.dbname);
+        if (mysql_library_init(0, NULL, NULL))
+            throw std::runtime_error("mysql_library_init failed");
 
-        int srv = ::socket(AF_INET, SOCK_STREAM, 0);
-        if (srv < 0)
-            throw std::runtime_error("socket failed");
+        if (!args.tablebase.empty())
+            endgame_tablebase().open(args.tablebase);
+        if (!args.map_pack.empty())
+            shared_map_pack().open(args.map_pack);
+        if (!args.static_dir.empty())
+            static_files().open(args.static_dir, args.static_prefix);
 
-        int one = 1;
-        setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
-
-        sockaddr_in addr;
-        std::memset(&addr, 0, sizeof(addr));
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons(static_cast<uint16_t>(args.port));
-        addr.sin_addr.s_addr = inet_addr(args.listen.c_str());
-
-        if (::bind(srv, (sockaddr *)&addr, sizeof(addr)) < 0)
+        if (args.workers <= 1 && args.handoff.empty() && args.takeover.empty())
         {
-            throw std::runtime_error(std::string("bind failed: ") +
-                                     std::strerror(errno));
+            run_worker(args, open_listener(args));
+            return 0;
         }
-        if (::listen(srv, 16) < 0)
-            throw std::runtime_error("listen failed");
-
-        std::fprintf(stderr, "[%s] Kepler's Horizon_server listening on %s:%d\n",
-                     now_iso().c_str(), args.listen.c_str(), args.port);
 
-        while (true)
+        std::vector<int> fds;
+        if (!args.takeover.empty())
+            fds = take_over_listeners(args.takeover);
+        else if (!args.unix_path.empty())
         {
-            sockaddr_in cli;
-            socklen_t clen = sizeof(cli);
-            int fd = ::accept(srv, (sockaddr *)&cli, &clen);
-            if (fd < 0)
-                continue;
-
-            HttpRequest req = http_parse(fd);
-            HttpResponse resp;
-
-            try
-            {
-                dispatch_request((const HttpRequest *)&req, &db,
-                                 (HttpResponse *)&resp);
-            }
-            catch (const std::exception &e)
-            {
-                resp.status = 500;
-                resp.body =
-                    json_error(std::string("server error: ") + e.what());
-            }
-
-            std::string out = http_serialize(resp);
-
-            // debug
-            // std::cout << "serialized output from dispatch result: " << std::endl
-            //          << out.c_str()
-            //          << std::endl;
-
-            ::send(fd, out.c_str(), out.size(), 0);
-            ::close(fd);
+            // No SO_REUSEPORT for Unix sockets: workers share one.
+            fds.assign(std::max(1, args.workers), open_listener(args));
         }
+        else
+        {
+            for (int i = 0; i < std::max(1, args.workers); i++)
+                fds.push_back(open_listener(args));
+        }
+
+        // Other processes now write the same games.
+        snapshot_check_versions(true);
+        return supervise(args, fds, run_worker);
     }
     catch (const std::exception &e)
     {
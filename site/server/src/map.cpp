@@ -0,0 +1,538 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "map.h"
+
+#include <fstream>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "app.h"
+#include "mappack.h"
+#include "util.h"
+
+static std::vector<std::string> split_csv_line(const std::string &line)
+{
+    std::vector<std::string> out;
+    size_t p = 0;
+    while (true)
+    {
+        size_t e = line.find(',', p);
+        if (e == std::string::npos)
+        {
+            out.push_back(trim(line.substr(p)));
+            break;
+        }
+        out.push_back(trim(line.substr(p, e - p)));
+        p = e + 1;
+    }
+    return out;
+}
+
+GameMap build_map(const std::vector<MapSystemRow> &systems,
+                  const std::vector<std::pair<std::string, std::string>> &links)
+{
+    GameMap m;
+
+    std::vector<MapSystemRow> sorted = systems;
+    std::sort(sorted.begin(), sorted.end(),
+              [](const MapSystemRow &x, const MapSystemRow &y) {
+                  return x.hex < y.hex;
+              });
+
+    for (auto &sys : sorted)
+    {
+        int id = (int)m.names.size();
+        m.names.push_back(sys.name);
+        m.hexes.push_back(sys.hex);
+        char bo = (sys.is_base && (sys.base_owner == 'A' ||
+                                   sys.base_owner == 'B'))
+                      ? sys.base_owner
+                      : 0;
+        m.base_owner.push_back(bo);
+        if (bo)
+            m.bases[bo == 'A' ? 0 : 1].push_back(id);
+        m.by_name[sys.name] = id;
+        m.by_hex[sys.hex] = id;
+    }
+
+    int n = m.size();
+    std::vector<std::vector<int>> lists(n);
+    for (auto &l : links)
+    {
+        int a = m.region_of_hex(l.first);
+        int b = m.region_of_hex(l.second);
+        if (a < 0 || b < 0 || a == b)
+            continue;
+        lists[a].push_back(b);
+        lists[b].push_back(a);
+    }
+
+    m.adj_off.resize(n + 1);
+    m.adj_off[0] = 0;
+    for (int i = 0; i < n; i++)
+    {
+        std::sort(lists[i].begin(), lists[i].end());
+        lists[i].erase(std::unique(lists[i].begin(), lists[i].end()),
+                       lists[i].end());
+        m.adj_off[i + 1] = m.adj_off[i] + (int)lists[i].size();
+        m.adj.insert(m.adj.end(), lists[i].begin(), lists[i].end());
+    }
+    return m;
+}
+
+static GameMap load_template(Db *db, int map_id)
+{
+    std::vector<MapSystemRow> systems;
+    auto rows = db->query(
+        "SELECT hex_id,name,is_base,base_owner FROM star_systems WHERE "
+        "map_id=" +
+        std::to_string(map_id));
+    for (auto &r : rows)
+    {
+        MapSystemRow sys;
+        sys.hex = r[0];
+        sys.name = r[1];
+        sys.is_base = (r[2] == "1");
+        sys.base_owner = r[3].empty() ? 0 : r[3][0];
+        systems.push_back(sys);
+    }
+
+    std::vector<std::pair<std::string, std::string>> links;
+    auto wl = db->query("SELECT a_hex,b_hex FROM warplines WHERE map_id=" +
+                        std::to_string(map_id) + " ORDER BY id");
+    for (auto &r : wl)
+        links.push_back(std::make_pair(r[0], r[1]));
+
+    GameMap m = build_map(systems, links);
+    m.map_id = map_id;
+    return m;
+}
+
+static MapGeometry load_template_geometry(Db *db, int map_id)
+{
+    MapGeometry g;
+    std::string gid = std::to_string(map_id);
+
+    auto rows = db->query("SELECT hex_id,q,r FROM hexes WHERE map_id=" + gid +
+                          " ORDER BY hex_id");
+    for (auto &r : rows)
+    {
+        MapHex h;
+        h.hex = r[0];
+        h.q = std::atoi(r[1].c_str());
+        h.r = std::atoi(r[2].c_str());
+        g.hexes.push_back(h);
+    }
+
+    std::map<int, size_t> by_id;
+    auto wl = db->query("SELECT id,a_hex,b_hex FROM warplines WHERE map_id=" +
+                        gid + " ORDER BY id");
+    for (auto &r : wl)
+    {
+        MapWarpline w;
+        w.id = std::atoi(r[0].c_str());
+        w.a_hex = r[1];
+        w.b_hex = r[2];
+        by_id[w.id] = g.warplines.size();
+        g.warplines.push_back(w);
+    }
+
+    auto path = db->query("SELECT warpline_id,hex_id FROM warpline_hexes "
+                          "WHERE map_id=" +
+                          gid + " ORDER BY warpline_id,hex_id");
+    for (auto &r : path)
+    {
+        auto it = by_id.find(std::atoi(r[0].c_str()));
+        if (it != by_id.end())
+            g.warplines[it->second].path.push_back(r[1]);
+    }
+    return g;
+}
+
+// Templates are immutable, so each is loaded once and shared by every game
+// (and thread) that plays on it. A template in the map pack comes from
+// there instead of the database. One with no rows is not kept, so seeding
+// it later takes effect.
+class TemplateCache
+{
+  public:
+    std::mutex mu;
+    std::map<int, MapPtr> maps;
+    std::map<int, GeometryPtr> geometry;
+    std::map<int, NameIndexPtr> names;
+};
+
+static TemplateCache &templates()
+{
+    static TemplateCache c;
+    return c;
+}
+
+static bool in_pack(int map_id)
+{
+    return shared_map_pack().loaded() &&
+           (int)shared_map_pack().header().map_id == map_id;
+}
+
+MapPtr map_template(Db *db, int map_id)
+{
+    if (in_pack(map_id))
+        return MapPtr(MapPtr(), &shared_map_pack().map());
+    TemplateCache &c = templates();
+    {
+        std::lock_guard<std::mutex> g(c.mu);
+        auto it = c.maps.find(map_id);
+        if (it != c.maps.end())
+            return it->second;
+    }
+    MapPtr m = std::make_shared<const GameMap>(load_template(db, map_id));
+    if (m->size() == 0)
+        return m;
+    std::lock_guard<std::mutex> g(c.mu);
+    // Keep the first copy if another thread loaded it meanwhile.
+    auto ins = c.maps.insert(std::make_pair(map_id, m));
+    return ins.first->second;
+}
+
+GeometryPtr map_template_geometry(Db *db, int map_id)
+{
+    if (in_pack(map_id))
+        return GeometryPtr(GeometryPtr(), &shared_map_pack().geometry());
+    TemplateCache &c = templates();
+    {
+        std::lock_guard<std::mutex> g(c.mu);
+        auto it = c.geometry.find(map_id);
+        if (it != c.geometry.end())
+            return it->second;
+    }
+    GeometryPtr geo =
+        std::make_shared<const MapGeometry>(load_template_geometry(db, map_id));
+    if (geo->hexes.empty())
+        return geo;
+    std::lock_guard<std::mutex> g(c.mu);
+    auto ins = c.geometry.insert(std::make_pair(map_id, geo));
+    return ins.first->second;
+}
+
+NameIndexPtr map_system_names(Db *db, int map_id)
+{
+    TemplateCache &c = templates();
+    {
+        std::lock_guard<std::mutex> g(c.mu);
+        auto it = c.names.find(map_id);
+        if (it != c.names.end())
+            return it->second;
+    }
+    MapPtr m = map_template(db, map_id);
+    NameIndexPtr idx = std::make_shared<const NameIndex>(m->names);
+    if (m->size() == 0)
+        return idx;
+    std::lock_guard<std::mutex> g(c.mu);
+    auto ins = c.names.insert(std::make_pair(map_id, idx));
+    return ins.first->second;
+}
+
+// A game's map_id never changes. Its map (the template, or its own copy
+// with the overlay applied) is kept for the version of the game it was read
+// at, so system_overlays is only queried again once the game has moved on.
+// The KH_MAP_GAMES most recently used games are kept.
+class GameMapCache
+{
+  public:
+    class Entry
+    {
+      public:
+        int map_id;
+        int version; // -1: only map_id is known
+        MapPtr map;
+    };
+
+    bool get(int game_id, Entry *out)
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = entries.find(game_id);
+        if (it == entries.end())
+            return false;
+        order.splice(order.begin(), order, it->second.lru);
+        *out = it->second.e;
+        return true;
+    }
+
+    void put(int game_id, const Entry &e)
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = entries.find(game_id);
+        if (it != entries.end())
+        {
+            if (e.map || !it->second.e.map)
+                it->second.e = e;
+            order.splice(order.begin(), order, it->second.lru);
+            return;
+        }
+        order.push_front(game_id);
+        Slot sl = {e, order.begin()};
+        entries[game_id] = sl;
+        while (entries.size() > KH_MAP_GAMES)
+        {
+            entries.erase(order.back());
+            order.pop_back();
+        }
+    }
+
+  private:
+    struct Slot
+    {
+        Entry e;
+        std::list<int>::iterator lru;
+    };
+    std::mutex mu;
+    std::list<int> order; // most recently used first
+    std::unordered_map<int, Slot> entries;
+};
+
+static GameMapCache &game_maps()
+{
+    static GameMapCache c;
+    return c;
+}
+
+int game_map_id(Db *db, int game_id)
+{
+    GameMapCache::Entry e;
+    if (game_maps().get(game_id, &e))
+        return e.map_id;
+    auto r = db->query("SELECT map_id FROM games WHERE id=" +
+                       std::to_string(game_id));
+    if (r.empty())
+        throw std::runtime_error("no game " + std::to_string(game_id));
+    e.map_id = std::atoi(r[0][0].c_str());
+    e.version = -1;
+    game_maps().put(game_id, e);
+    return e.map_id;
+}
+
+MapPtr game_map(Db *db, int game_id, int version)
+{
+    GameMapCache::Entry prev;
+    bool have = game_maps().get(game_id, &prev);
+    if (have && prev.map && version >= 0 && prev.version == version)
+        return prev.map;
+
+    int map_id = have ? prev.map_id : game_map_id(db, game_id);
+    MapPtr t = map_template(db, map_id);
+    auto rows = db->query("SELECT name,base_owner FROM system_overlays WHERE "
+                          "game_id=" +
+                          std::to_string(game_id) + " ORDER BY name");
+    uint64_t h = 1469598103934665603ULL;
+    for (auto &r : rows)
+    {
+        if (t->region_of_name(r[0]) < 0)
+            continue;
+        for (char c : r[0] + "=" + r[1] + ";")
+        {
+            h ^= (unsigned char)c;
+            h *= 1099511628211ULL;
+        }
+    }
+
+    MapPtr m = t;
+    if (!rows.empty() && have && prev.map && prev.map->overlay == h &&
+        prev.map->map_id == t->map_id)
+        m = prev.map;
+    else if (!rows.empty())
+    {
+        // Copy-on-write: only games that changed something get their own map.
+        std::shared_ptr<GameMap> o = std::make_shared<GameMap>(*t);
+        for (auto &r : rows)
+        {
+            int region = o->region_of_name(r[0]);
+            if (region < 0)
+                continue;
+            char bo = r[1].empty() ? 0 : r[1][0];
+            o->base_owner[region] = (bo == 'A' || bo == 'B') ? bo : 0;
+        }
+        o->bases[0].clear();
+        o->bases[1].clear();
+        for (int i = 0; i < o->size(); i++)
+            if (o->base_owner[i])
+                o->bases[o->base_owner[i] == 'A' ? 0 : 1].push_back(i);
+        o->overlay = h;
+        m = o;
+    }
+
+    // An empty template is not kept (see TemplateCache), nor is its game's map.
+    if (t->size() > 0)
+    {
+        GameMapCache::Entry e = {map_id, version, m};
+        game_maps().put(game_id, e);
+    }
+    return m;
+}
+
+GeometryPtr game_map_geometry(Db *db, int game_id)
+{
+    return map_template_geometry(db, game_map_id(db, game_id));
+}
+
+// Reads the seed CSVs (star_systems.csv, warplines.csv) from 'dir', keeping
+// only rows for template 'map_id'. Used by offline tools that run without a
+// database.
+GameMap load_map_csv(const std::string &dir, int map_id)
+{
+    std::string gid = std::to_string(map_id);
+
+    std::vector<MapSystemRow> systems;
+    {
+        std::ifstream in((dir + "/star_systems.csv").c_str());
+        if (!in)
+            throw std::runtime_error("cannot open " + dir +
+                                     "/star_systems.csv");
+        std::string line;
+        while (std::getline(in, line))
+        {
+            auto f = split_csv_line(line);
+            if (f.size() < 4 || f[0] != gid)
+                continue;
+            MapSystemRow sys;
+            sys.hex = f[1];
+            sys.name = f[2];
+            sys.is_base = (f[3] == "1");
+            sys.base_owner = (f.size() > 4 && !f[4].empty()) ? f[4][0] : 0;
+            systems.push_back(sys);
+        }
+    }
+
+    std::vector<std::pair<std::string, std::string>> links;
+    {
+        std::ifstream in((dir + "/warplines.csv").c_str());
+        if (!in)
+            throw std::runtime_error("cannot open " + dir + "/warplines.csv");
+        std::string line;
+        while (std::getline(in, line))
+        {
+            auto f = split_csv_line(line);
+            if (f.size() < 3 || f[0] != gid)
+                continue;
+            links.push_back(std::make_pair(f[1], f[2]));
+        }
+    }
+
+    GameMap m = build_map(systems, links);
+    m.map_id = map_id;
+    return m;
+}
+
+// Geometry from the seed CSVs (hexes.csv, warplines.csv, warpline_hexes.csv)
+// for template 'map_id'. Warplines are numbered 1.. in file order, as
+// loading them into an empty warplines table would.
+MapGeometry load_map_geometry_csv(const std::string &dir, int map_id)
+{
+    std::string gid = std::to_string(map_id);
+    MapGeometry g;
+    auto open = [&](const char *name, std::ifstream &in) {
+        in.open((dir + "/" + name).c_str());
+        if (!in)
+            throw std::runtime_error("cannot open " + dir + "/" + name);
+    };
+    std::string line;
+
+    std::ifstream hx;
+    open("hexes.csv", hx);
+    while (std::getline(hx, line))
+    {
+        auto f = split_csv_line(line);
+        if (f.size() < 4 || f[0] != gid)
+            continue;
+        MapHex h;
+        h.hex = f[1];
+        h.q = std::atoi(f[2].c_str());
+        h.r = std::atoi(f[3].c_str());
+        g.hexes.push_back(h);
+    }
+    std::sort(g.hexes.begin(), g.hexes.end(),
+              [](const MapHex &x, const MapHex &y) { return x.hex < y.hex; });
+
+    std::ifstream wl;
+    open("warplines.csv", wl);
+    while (std::getline(wl, line))
+    {
+        auto f = split_csv_line(line);
+        if (f.size() < 3 || f[0] != gid)
+            continue;
+        MapWarpline w;
+        w.id = (int)g.warplines.size() + 1;
+        w.a_hex = f[1];
+        w.b_hex = f[2];
+        g.warplines.push_back(w);
+    }
+
+    std::ifstream wh;
+    open("warpline_hexes.csv", wh);
+    while (std::getline(wh, line))
+    {
+        auto f = split_csv_line(line);
+        if (f.size() < 3 || f[0] != gid)
+            continue;
+        int id = std::atoi(f[1].c_str());
+        if (id >= 1 && id <= (int)g.warplines.size())
+            g.warplines[id - 1].path.push_back(f[2]);
+    }
+    for (auto &w : g.warplines)
+        std::sort(w.path.begin(), w.path.end());
+    return g;
+}
+
+// FNV-1a over the region table and adjacency; identifies a map layout in
+// files built offline for it.
+uint64_t map_fingerprint(const GameMap &m)
+{
+    uint64_t h = 1469598103934665603ULL;
+    auto mix = [&](const std::string &v) {
+        for (size_t i = 0; i < v.size(); i++)
+        {
+            h ^= (unsigned char)v[i];
+            h *= 1099511628211ULL;
+        }
+        h ^= 0xff;
+        h *= 1099511628211ULL;
+    };
+    for (int i = 0; i < m.size(); i++)
+    {
+        mix(m.hexes[i]);
+        mix(std::string(1, m.base_owner[i] ? m.base_owner[i] : '-'));
+        for (const int *n = m.neighbors_begin(i); n != m.neighbors_end(i); ++n)
+            mix(std::to_string(*n));
+    }
+    return h;
+}
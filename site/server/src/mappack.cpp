@@ -0,0 +1,296 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "mappack.h"
+
+#include <fstream>
+
+#include "app.h"
+
+static uint64_t fnv1a(const char *p, size_t n)
+{
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < n; i++)
+    {
+        h ^= (unsigned char)p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Appends 'n' bytes at the next 8-byte boundary; returns their offset.
+static uint64_t put(std::string &out, const void *p, size_t n)
+{
+    out.append((8 - out.size() % 8) % 8, '\0');
+    uint64_t off = out.size();
+    out.append((const char *)p, n);
+    return off;
+}
+
+class StringTable
+{
+  public:
+    uint32_t add(const std::string &s)
+    {
+        auto it = at.find(s);
+        if (it != at.end())
+            return it->second;
+        uint32_t off = (uint32_t)data.size();
+        data += s;
+        data += '\0';
+        at[s] = off;
+        return off;
+    }
+    std::string data;
+
+  private:
+    std::map<std::string, uint32_t> at;
+};
+
+void build_map_pack(const GameMap &m, const MapGeometry &g, int map_id,
+                    const std::string &path)
+{
+    int n = m.size();
+    StringTable strings;
+
+    std::vector<MapPackRegion> regions(n);
+    for (int i = 0; i < n; i++)
+    {
+        std::memset(&regions[i], 0, sizeof(MapPackRegion));
+        regions[i].name = strings.add(m.names[i]);
+        regions[i].hex = strings.add(m.hexes[i]);
+        regions[i].base_owner = (uint8_t)m.base_owner[i];
+    }
+    std::vector<uint32_t> adj_off(m.adj_off.begin(), m.adj_off.end());
+    std::vector<uint32_t> adj(m.adj.begin(), m.adj.end());
+
+    std::vector<MapPackHex> hexes(g.hexes.size());
+    for (size_t i = 0; i < g.hexes.size(); i++)
+    {
+        hexes[i].hex = strings.add(g.hexes[i].hex);
+        hexes[i].q = g.hexes[i].q;
+        hexes[i].r = g.hexes[i].r;
+    }
+    std::vector<MapPackWarpline> warplines(g.warplines.size());
+    std::vector<uint32_t> paths;
+    for (size_t i = 0; i < g.warplines.size(); i++)
+    {
+        const MapWarpline &w = g.warplines[i];
+        warplines[i].id = w.id;
+        warplines[i].a_hex = strings.add(w.a_hex);
+        warplines[i].b_hex = strings.add(w.b_hex);
+        warplines[i].path_off = (uint32_t)paths.size();
+        warplines[i].path_len = (uint32_t)w.path.size();
+        for (auto &h : w.path)
+            paths.push_back(strings.add(h));
+    }
+
+    MapPackHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, KH_MP_MAGIC, sizeof(h.magic));
+    h.format = KH_MP_FORMAT;
+    h.map_id = (uint32_t)map_id;
+    h.map_hash = map_fingerprint(m);
+    h.regions = (uint32_t)n;
+    h.adj_count = (uint32_t)adj.size();
+    h.hexes = (uint32_t)hexes.size();
+    h.warplines = (uint32_t)warplines.size();
+    h.path_count = (uint32_t)paths.size();
+    h.strings_size = (uint32_t)strings.data.size();
+
+    std::string out((const char *)&h, sizeof(h));
+    h.off_regions = put(out, regions.data(), regions.size() * sizeof(regions[0]));
+    h.off_adj_off = put(out, adj_off.data(), adj_off.size() * sizeof(uint32_t));
+    h.off_adj = put(out, adj.data(), adj.size() * sizeof(uint32_t));
+    h.off_hexes = put(out, hexes.data(), hexes.size() * sizeof(hexes[0]));
+    h.off_warplines =
+        put(out, warplines.data(), warplines.size() * sizeof(warplines[0]));
+    h.off_path = put(out, paths.data(), paths.size() * sizeof(uint32_t));
+    h.off_strings = put(out, strings.data.data(), strings.data.size());
+    out.append((8 - out.size() % 8) % 8, '\0');
+    h.size = out.size();
+    h.checksum = fnv1a(out.data() + sizeof(h), out.size() - sizeof(h));
+    out.replace(0, sizeof(h), (const char *)&h, sizeof(h));
+
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("map pack: cannot write " + path);
+    bool ok = std::fwrite(out.data(), 1, out.size(), f) == out.size();
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        throw std::runtime_error("map pack: short write to " + path);
+}
+
+MapPack::MapPack() : is_loaded(false), base(NULL)
+{
+    std::memset(&hdr, 0, sizeof(hdr));
+}
+
+// Whether [off, off + count * size) lies inside a file of 'len' bytes.
+static bool in_file(uint64_t off, uint64_t count, size_t size, size_t len)
+{
+    return off % 8 == 0 && off <= len && count <= (len - off) / size;
+}
+
+void MapPack::open(const std::string &path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+    if (!in)
+        throw std::runtime_error("map pack: cannot open " + path);
+    size_t n = (size_t)in.tellg();
+    if (n < sizeof(MapPackHeader))
+        throw std::runtime_error("map pack: truncated " + path);
+    // uint64_t words, so every 8-byte aligned section is aligned in memory
+    std::vector<uint64_t> buf((n + 7) / 8);
+    in.seekg(0);
+    if (!in.read((char *)buf.data(), n))
+        throw std::runtime_error("map pack: cannot read " + path);
+
+    const char *p = (const char *)buf.data();
+    const MapPackHeader *h = (const MapPackHeader *)p;
+    bool ok =
+        std::memcmp(h->magic, KH_MP_MAGIC, sizeof(h->magic)) == 0 &&
+        h->format == KH_MP_FORMAT && h->size == n &&
+        in_file(h->off_regions, h->regions, sizeof(MapPackRegion), n) &&
+        in_file(h->off_adj_off, (uint64_t)h->regions + 1, 4, n) &&
+        in_file(h->off_adj, h->adj_count, 4, n) &&
+        in_file(h->off_hexes, h->hexes, sizeof(MapPackHex), n) &&
+        in_file(h->off_warplines, h->warplines, sizeof(MapPackWarpline), n) &&
+        in_file(h->off_path, h->path_count, 4, n) &&
+        in_file(h->off_strings, h->strings_size, 1, n);
+    if (!ok)
+        throw std::runtime_error("map pack: bad header in " + path);
+    if (fnv1a(p + sizeof(MapPackHeader), n - sizeof(MapPackHeader)) !=
+        h->checksum)
+        throw std::runtime_error("map pack: checksum mismatch in " + path);
+
+    // The file is only read while decoding; it is freed on return.
+    is_loaded = false;
+    base = p;
+    hdr = *h;
+    try
+    {
+        decode();
+        base = NULL;
+        if (map_fingerprint(game_map) != hdr.map_hash)
+            throw std::runtime_error("map hash mismatch");
+    }
+    catch (const std::exception &e)
+    {
+        base = NULL;
+        throw std::runtime_error(std::string("map pack: ") + e.what() +
+                                 " in " + path);
+    }
+    is_loaded = true;
+}
+
+const char *MapPack::str(uint32_t off) const
+{
+    const char *s = base + hdr.off_strings;
+    if (off >= hdr.strings_size ||
+        !std::memchr(s + off, '\0', hdr.strings_size - off))
+        throw std::runtime_error("bad string offset");
+    return s + off;
+}
+
+void MapPack::decode()
+{
+    const char *b = base;
+    const MapPackRegion *rg = (const MapPackRegion *)(b + hdr.off_regions);
+    const uint32_t *adj_off = (const uint32_t *)(b + hdr.off_adj_off);
+    const uint32_t *adj = (const uint32_t *)(b + hdr.off_adj);
+    int n = (int)hdr.regions;
+
+    GameMap m;
+    for (int i = 0; i < n; i++)
+    {
+        m.names.push_back(str(rg[i].name));
+        m.hexes.push_back(str(rg[i].hex));
+        char bo = (char)rg[i].base_owner;
+        m.base_owner.push_back(bo);
+        if (bo == 'A' || bo == 'B')
+            m.bases[bo == 'A' ? 0 : 1].push_back(i);
+        m.by_name[m.names[i]] = i;
+        m.by_hex[m.hexes[i]] = i;
+    }
+    if (adj_off[0] != 0 || adj_off[n] != hdr.adj_count)
+        throw std::runtime_error("bad adjacency");
+    for (int i = 0; i <= n; i++)
+    {
+        if (i && adj_off[i] < adj_off[i - 1])
+            throw std::runtime_error("bad adjacency");
+        m.adj_off.push_back((int)adj_off[i]);
+    }
+    for (uint32_t i = 0; i < hdr.adj_count; i++)
+    {
+        if (adj[i] >= (uint32_t)n)
+            throw std::runtime_error("bad adjacency");
+        m.adj.push_back((int)adj[i]);
+    }
+
+    MapGeometry g;
+    const MapPackHex *hx = (const MapPackHex *)(b + hdr.off_hexes);
+    for (uint32_t i = 0; i < hdr.hexes; i++)
+    {
+        MapHex h;
+        h.hex = str(hx[i].hex);
+        h.q = hx[i].q;
+        h.r = hx[i].r;
+        g.hexes.push_back(h);
+    }
+    const MapPackWarpline *wl =
+        (const MapPackWarpline *)(b + hdr.off_warplines);
+    const uint32_t *path = (const uint32_t *)(b + hdr.off_path);
+    for (uint32_t i = 0; i < hdr.warplines; i++)
+    {
+        MapWarpline w;
+        w.id = wl[i].id;
+        w.a_hex = str(wl[i].a_hex);
+        w.b_hex = str(wl[i].b_hex);
+        if (wl[i].path_off > hdr.path_count ||
+            wl[i].path_len > hdr.path_count - wl[i].path_off)
+            throw std::runtime_error("bad warpline path");
+        for (uint32_t k = 0; k < wl[i].path_len; k++)
+            w.path.push_back(str(path[wl[i].path_off + k]));
+        g.warplines.push_back(w);
+    }
+
+    m.map_id = (int)hdr.map_id;
+    game_map = m;
+    geo = g;
+}
+
+MapPack &shared_map_pack()
+{
+    static MapPack pack;
+    return pack;
+}
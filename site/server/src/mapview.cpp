@@ -0,0 +1,591 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "mapview.h"
+
+#include "app.h"
+#include "comms.h"
+#include "flight.h"
+#include "map.h"
+#include "snapshot.h"
+#include "spatial.h"
+#include "tiles.h"
+#include "util.h"
+
+#include <mutex>
+
+// Viewport queries covering more than this many hexes are thinned: each
+// level of detail halves the hex grid in both directions.
+#define KH_VIEW_HEXES 2048
+#define KH_VIEW_MAX_LOD 8
+
+static void encode_map(Encoder &e, const GameMap &m, const MapGeometry &g)
+{
+    e.begin_object();
+    e.key("ok");
+    e.boolean(true);
+    e.key("map");
+    e.num(m.map_id);
+
+    e.key("hexes");
+    e.begin_array();
+    for (auto &h : g.hexes)
+    {
+        e.begin_object();
+        e.key("hex");
+        e.str(h.hex);
+        e.key("q");
+        e.num(h.q);
+        e.key("r");
+        e.num(h.r);
+        e.end_object();
+    }
+    e.end_array();
+
+    e.key("systems");
+    e.begin_array();
+    for (int i = 0; i < m.size(); i++)
+    {
+        e.begin_object();
+        e.key("hex");
+        e.str(m.hexes[i]);
+        e.key("name");
+        e.str(m.names[i]);
+        e.key("type");
+        e.str(m.base_owner[i] ? "base" : "star");
+        e.key("owner");
+        e.str(m.base_owner[i] ? std::string(1, m.base_owner[i]) : "");
+        e.end_object();
+    }
+    e.end_array();
+
+    e.key("warplines");
+    e.begin_array();
+    for (auto &w : g.warplines)
+    {
+        e.begin_object();
+        e.key("id");
+        e.num(w.id);
+        e.key("a");
+        e.str(w.a_hex);
+        e.key("b");
+        e.str(w.b_hex);
+        e.key("path");
+        e.begin_array();
+        for (auto &h : w.path)
+            e.str(h);
+        e.end_array();
+        e.end_object();
+    }
+    e.end_array();
+    e.end_object();
+}
+
+static void index_map(MapDoc *d)
+{
+    const GameMap &m = *d->map;
+    const MapGeometry &g = *d->geo;
+    bool drawn = false;
+    int bx0 = 0, by0 = 0, bx1 = 0, by1 = 0;
+    auto board = [&](int x0, int y0, int x1, int y1) {
+        bx0 = drawn ? std::min(bx0, x0) : x0;
+        by0 = drawn ? std::min(by0, y0) : y0;
+        bx1 = drawn ? std::max(bx1, x1) : x1;
+        by1 = drawn ? std::max(by1, y1) : y1;
+        drawn = true;
+    };
+    std::map<std::string, int> at;
+    for (size_t i = 0; i < g.hexes.size(); i++)
+    {
+        at[g.hexes[i].hex] = (int)i;
+        d->hexes.insert((int)i, g.hexes[i].q, g.hexes[i].r, g.hexes[i].q,
+                        g.hexes[i].r);
+    }
+
+    // Board positions, laid out as map_view.html draws them: hex XXYY sits
+    // in row XX+YY (from the top), every other row shifted half a step.
+    int min_sum = 0;
+    for (size_t i = 0; i < g.hexes.size(); i++)
+        if (i == 0 || g.hexes[i].q + g.hexes[i].r < min_sum)
+            min_sum = g.hexes[i].q + g.hexes[i].r;
+    d->hex_x.resize(g.hexes.size());
+    d->hex_y.resize(g.hexes.size());
+    for (size_t i = 0; i < g.hexes.size(); i++)
+    {
+        int row = g.hexes[i].q + g.hexes[i].r - min_sum + 1;
+        int col = g.hexes[i].q - (row + 1) / 2;
+        d->hex_x[i] = ((row % 2) ? 100 : 40) + col * 120 + 40;
+        d->hex_y[i] = 20 + row * KH_HEX_HALF_H;
+        d->board_hexes.insert((int)i, (int)d->hex_x[i] - 40,
+                              (int)d->hex_y[i] - 35, (int)d->hex_x[i] + 40,
+                              (int)d->hex_y[i] + 35);
+        board((int)d->hex_x[i] - 40, (int)d->hex_y[i] - 35,
+              (int)d->hex_x[i] + 40, (int)d->hex_y[i] + 35);
+    }
+
+    d->sys_q.assign(m.size(), 0);
+    d->sys_r.assign(m.size(), 0);
+    d->sys_placed.assign(m.size(), 0);
+    d->sys_hex.assign(m.size(), -1);
+    for (int i = 0; i < m.size(); i++)
+    {
+        auto it = at.find(m.hexes[i]);
+        if (it == at.end())
+            continue;
+        d->sys_q[i] = g.hexes[it->second].q;
+        d->sys_r[i] = g.hexes[it->second].r;
+        d->sys_placed[i] = 1;
+        d->sys_hex[i] = it->second;
+        d->systems.insert(i, d->sys_q[i], d->sys_r[i], d->sys_q[i],
+                          d->sys_r[i]);
+        // Room for the icon, the name above and the fleet line below.
+        int x = (int)d->hex_x[it->second], y = (int)d->hex_y[it->second];
+        d->board_systems.insert(i, x - 80, y - 40, x + 80, y + 40);
+        board(x - 80, y - 40, x + 80, y + 40);
+    }
+
+    // A warpline is indexed by the box around its ends and path.
+    d->warp_a.assign(g.warplines.size(), -1);
+    d->warp_b.assign(g.warplines.size(), -1);
+    for (size_t i = 0; i < g.warplines.size(); i++)
+    {
+        const MapWarpline &w = g.warplines[i];
+        bool any = false;
+        int q0 = 0, r0 = 0, q1 = 0, r1 = 0;
+        auto add = [&](const std::string &hex) {
+            auto it = at.find(hex);
+            if (it == at.end())
+                return;
+            const MapHex &h = g.hexes[it->second];
+            q0 = any ? std::min(q0, h.q) : h.q;
+            r0 = any ? std::min(r0, h.r) : h.r;
+            q1 = any ? std::max(q1, h.q) : h.q;
+            r1 = any ? std::max(r1, h.r) : h.r;
+            any = true;
+        };
+        add(w.a_hex);
+        add(w.b_hex);
+        for (auto &h : w.path)
+            add(h);
+        if (any)
+            d->warplines.insert((int)i, q0, r0, q1, r1);
+
+        auto ia = at.find(w.a_hex), ib = at.find(w.b_hex);
+        if (ia != at.end() && ib != at.end())
+        {
+            d->warp_a[i] = ia->second;
+            d->warp_b[i] = ib->second;
+            double ax = d->hex_x[ia->second], ay = d->hex_y[ia->second];
+            double bx = d->hex_x[ib->second], by = d->hex_y[ib->second];
+            d->board_warplines.insert((int)i, (int)std::min(ax, bx) - 2,
+                                      (int)std::min(ay, by) - 2,
+                                      (int)std::max(ax, bx) + 2,
+                                      (int)std::max(ay, by) + 2);
+        }
+    }
+
+    // Warplines run between hex centres, so the hexes and systems bound
+    // the board.
+    d->tile_x0 = bx0;
+    d->tile_y0 = by0;
+    d->tile_span = KH_TILE_MIN_SPAN;
+    while (d->tile_span <= std::max(bx1 - bx0, by1 - by0))
+        d->tile_span *= 2;
+}
+
+static MapDocPtr build_map_doc(Db *db, const MapPtr &map)
+{
+    std::shared_ptr<MapDoc> d = std::make_shared<MapDoc>();
+    d->map = map;
+    d->geo = map_template_geometry(db, map->map_id);
+    const GameMap &m = *d->map;
+    const MapGeometry &g = *d->geo;
+    d->empty = (m.size() == 0 && g.hexes.empty());
+    index_map(d.get());
+    JsonEncoder j;
+    encode_map(j, m, g);
+    CborEncoder c;
+    encode_map(c, m, g);
+
+    // The tag is a hash of the content, so a re-seeded map gets a new one
+    // once the server restarts.
+    uint64_t h = 1469598103934665603ULL;
+    for (size_t i = 0; i < j.out.size(); i++)
+    {
+        h ^= (unsigned char)j.out[i];
+        h *= 1099511628211ULL;
+    }
+    char tag[64];
+    std::snprintf(tag, sizeof(tag), "\"m%d.%016llx\"", m.map_id,
+                  (unsigned long long)h);
+    d->etag = tag;
+    d->json.etag = d->etag;
+    d->json.content_type = j.content_type();
+    d->json.body.swap(j.out);
+    d->cbor.etag = d->etag.substr(0, d->etag.size() - 1) + ".c\"";
+    d->cbor.content_type = c.content_type();
+    d->cbor.body.swap(c.out);
+    return MapDocPtr(d);
+}
+
+MapDocPtr map_doc(Db *db, int game_id)
+{
+    static std::mutex mu;
+    static std::map<std::string, MapDocPtr> docs; // map_id.overlay
+    static SingleFlight<MapDoc> flight;
+
+    SnapshotPtr snap = current_snapshot(game_id);
+    MapPtr map = game_map(db, game_id, snap ? snap->state.version : -1);
+    std::string key =
+        std::to_string(map->map_id) + "." + std::to_string(map->overlay);
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = docs.find(key);
+        if (it != docs.end())
+            return it->second;
+    }
+    MapDocPtr d = flight.run(key, [&]() { return build_map_doc(db, map); });
+    if (!d->empty)
+    {
+        std::lock_guard<std::mutex> g(mu);
+        docs[key] = d;
+    }
+    return d;
+}
+
+void handle_map(const HttpRequest *req, Db *db, HttpResponse *resp)
+{
+    if (req->method != "GET")
+    {
+        resp->status = 405;
+        resp->body = json_error("method");
+        return;
+    }
+
+    int game_id;
+    std::string g = query_param(req->query, "game");
+    if (!g.empty())
+        game_id = std::atoi(g.c_str());
+    else
+    {
+        AuthContext a = require_auth(db, req, resp);
+        if (resp->status != 200)
+            return;
+        game_id = a.game_id;
+    }
+    if (game_id <= 0)
+    {
+        resp->status = 400;
+        resp->body = json_error("game");
+        return;
+    }
+
+    MapDocPtr d = map_doc(db, game_id);
+    if (d->empty)
+    {
+        resp->status = 404;
+        resp->body = json_error("no map for game");
+        return;
+    }
+
+    const CachedBody &b = wants_cbor(req) ? d->cbor : d->json;
+    resp->headers["Vary"] = "Accept";
+    if (not_modified(req, resp, b.etag))
+        return;
+    resp->content_type = b.content_type;
+    resp->body = b.body;
+}
+
+// Ships 'side' can place on the map: its own deployed ships, and the enemy
+// ships it has sighted (where they were last seen) as of 'snap'.
+std::vector<ViewShip> visible_ships(Db *db, const GameMap &m,
+                                    const GameSnapshot &snap, char side)
+{
+    std::vector<ViewShip> out;
+    std::string gid = std::to_string(snap.state.game_id);
+    std::string me(1, side);
+    char enemy = (side == 'A') ? 'B' : 'A';
+    auto own = db->query("SELECT ship_code,ship_name,ship_type,at_system FROM "
+                         "ships WHERE game_id=" +
+                         gid + " AND owner='" + me +
+                         "' AND racked_in IS NULL AND at_system IS NOT NULL");
+    for (auto &r : own)
+    {
+        ViewShip v = {side, r[0], r[1], r[2], "", m.region_of_name(r[3])};
+        if (v.region >= 0)
+            out.push_back(v);
+    }
+
+    // The scan state sees ships mid-turn; the table only as of the last
+    // turn change.
+    SeenShipsPtr seen = std::atomic_load(&snap.seen[side == 'B' ? 1 : 0]);
+    if (seen)
+    {
+        for (auto &s : *seen)
+        {
+            ViewShip v = {enemy, s.code, s.name, s.type, s.seen,
+                          m.region_of_name(s.at_system)};
+            if (v.region >= 0)
+                out.push_back(v);
+        }
+        return out;
+    }
+    auto rows = db->query("SELECT ship_code,ship_name,ship_type,at_system,"
+                          "last_seen_turn FROM sightings WHERE game_id=" +
+                          gid + " AND observer_owner='" + me + "'");
+    for (auto &r : rows)
+    {
+        ViewShip v = {enemy, r[0], r[1], r[2], r[4], m.region_of_name(r[3])};
+        if (v.region >= 0)
+            out.push_back(v);
+    }
+    return out;
+}
+
+static bool int_param(const std::string &query, const char *key, int *v)
+{
+    std::string s = query_param(query, key);
+    if (s.empty())
+        return false;
+    char *end = NULL;
+    long n = std::strtol(s.c_str(), &end, 10);
+    if (*end || n < -1000000000L || n > 1000000000L)
+        return false;
+    *v = (int)n;
+    return true;
+}
+
+// Positive remainder, for thinning negative coordinates too.
+static int pmod(int v, int m)
+{
+    int r = v % m;
+    return (r < 0) ? r + m : r;
+}
+
+void handle_view(const HttpRequest *req, Db *db, HttpResponse *resp)
+{
+    if (req->method != "GET")
+    {
+        resp->status = 405;
+        resp->body = json_error("method");
+        return;
+    }
+    AuthContext a = require_auth(db, req, resp);
+    if (resp->status != 200)
+        return;
+
+    int q0, r0, q1, r1;
+    if (!int_param(req->query, "q0", &q0) ||
+        !int_param(req->query, "r0", &r0) ||
+        !int_param(req->query, "q1", &q1) || !int_param(req->query, "r1", &r1))
+    {
+        resp->status = 400;
+        resp->body = json_error("q0, r0, q1 and r1 are required");
+        return;
+    }
+    if (q0 > q1)
+        std::swap(q0, q1);
+    if (r0 > r1)
+        std::swap(r0, r1);
+
+    MapDocPtr d = map_doc(db, a.game_id);
+    if (d->empty)
+    {
+        resp->status = 404;
+        resp->body = json_error("no map for game");
+        return;
+    }
+
+    // Level of detail: enough to keep about KH_VIEW_HEXES hexes in the
+    // rectangle; clients may ask for a coarser one with ?lod=.
+    double area = ((double)q1 - q0 + 1) * ((double)r1 - r0 + 1);
+    int lod = 0;
+    while (lod < KH_VIEW_MAX_LOD && area / (double)(1 << (2 * lod)) >
+                                        (double)KH_VIEW_HEXES)
+        lod++;
+    int want;
+    if (int_param(req->query, "lod", &want))
+        lod = std::max(lod, std::min(want, KH_VIEW_MAX_LOD));
+    int stride = 1 << lod;
+
+    SnapshotPtr snap = game_snapshot(db, a.game_id);
+    char side = owner_for_username(a.username);
+    std::ostringstream tag;
+    tag << "\"v" << a.game_id << "." << snap->state.version << "." << side
+        << "." << q0 << "." << r0 << "." << q1 << "." << r1 << "." << lod;
+    if (wants_cbor(req))
+        tag << ".c";
+    tag << "\"";
+    resp->headers["Vary"] = "Accept";
+    if (not_modified(req, resp, tag.str()))
+        return;
+
+    const GameMap &m = *d->map;
+    const MapGeometry &g = *d->geo;
+    std::unique_ptr<Encoder> e = response_encoder(req);
+    e->begin_object();
+    e->key("ok");
+    e->boolean(true);
+    e->key("game");
+    e->num(a.game_id);
+    e->key("version");
+    e->num(snap->state.version);
+    e->key("lod");
+    e->num(lod);
+
+    // Hexes: every stride-th row and column when thinned.
+    e->key("hexes");
+    e->begin_array();
+    for (int i : d->hexes.query(q0, r0, q1, r1))
+    {
+        const MapHex &h = g.hexes[i];
+        if (lod && (pmod(h.q, stride) || pmod(h.r, stride)))
+            continue;
+        e->begin_object();
+        e->key("hex");
+        e->str(h.hex);
+        e->key("q");
+        e->num(h.q);
+        e->key("r");
+        e->num(h.r);
+        e->end_object();
+    }
+    e->end_array();
+
+    // Systems: only bases from level 2 on.
+    std::vector<int> regions = d->systems.query(q0, r0, q1, r1);
+    e->key("systems");
+    e->begin_array();
+    for (int i : regions)
+    {
+        if (lod >= 2 && !m.base_owner[i])
+            continue;
+        e->begin_object();
+        e->key("hex");
+        e->str(m.hexes[i]);
+        e->key("name");
+        e->str(m.names[i]);
+        e->key("type");
+        e->str(m.base_owner[i] ? "base" : "star");
+        e->key("owner");
+        e->str(m.base_owner[i] ? std::string(1, m.base_owner[i]) : "");
+        e->end_object();
+    }
+    e->end_array();
+
+    // Warplines: ends only (no path) when thinned.
+    e->key("warplines");
+    e->begin_array();
+    for (int i : d->warplines.query(q0, r0, q1, r1))
+    {
+        const MapWarpline &w = g.warplines[i];
+        e->begin_object();
+        e->key("id");
+        e->num(w.id);
+        e->key("a");
+        e->str(w.a_hex);
+        e->key("b");
+        e->str(w.b_hex);
+        if (!lod)
+        {
+            e->key("path");
+            e->begin_array();
+            for (auto &h : w.path)
+                e->str(h);
+            e->end_array();
+        }
+        e->end_object();
+    }
+    e->end_array();
+
+    // Ships: one by one, or counted per system and side when thinned.
+    std::vector<char> in_view(m.size(), 0);
+    for (int i : regions)
+        in_view[i] = 1;
+    std::vector<ViewShip> ships = visible_ships(db, m, *snap, side);
+    if (!lod)
+    {
+        e->key("ships");
+        e->begin_array();
+        for (auto &v : ships)
+        {
+            if (!in_view[v.region])
+                continue;
+            e->begin_object();
+            e->key("owner");
+            e->str(std::string(1, v.owner));
+            e->key("code");
+            e->str(v.code);
+            e->key("name");
+            e->str(v.name);
+            e->key("type");
+            e->str(v.type);
+            e->key("system");
+            e->str(m.names[v.region]);
+            e->key("hex");
+            e->str(m.hexes[v.region]);
+            if (!v.seen.empty())
+            {
+                e->key("seen");
+                e->str(v.seen);
+            }
+            e->end_object();
+        }
+        e->end_array();
+    }
+    else
+    {
+        std::map<int, std::pair<int, int>> count; // region -> (A, B)
+        for (auto &v : ships)
+            if (in_view[v.region])
+                (v.owner == 'A' ? count[v.region].first
+                                : count[v.region].second)++;
+        e->key("fleets");
+        e->begin_array();
+        for (auto &c : count)
+        {
+            e->begin_object();
+            e->key("system");
+            e->str(m.names[c.first]);
+            e->key("hex");
+            e->str(m.hexes[c.first]);
+            e->key("A");
+            e->num(c.second.first);
+            e->key("B");
+            e->num(c.second.second);
+            e->end_object();
+        }
+        e->end_array();
+    }
+    e->end_object();
+    set_body(resp, *e);
+}
@@ -0,0 +1,120 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "names.h"
+
+#include "app.h"
+
+std::string fold_name(const std::string &s)
+{
+    std::string r = s;
+    for (size_t i = 0; i < r.size(); i++)
+        r[i] = (char)std::toupper((unsigned char)r[i]);
+    return r;
+}
+
+NameIndex::NameIndex(const std::vector<std::string> &names)
+{
+    std::vector<std::pair<std::string, std::string>> all;
+    for (auto &n : names)
+        all.push_back(std::make_pair(fold_name(n), n));
+    std::sort(all.begin(), all.end());
+
+    std::vector<std::string> folded;
+    for (auto &p : all)
+    {
+        by_folded.insert(std::make_pair(p.first, (uint32_t)sorted.size()));
+        folded.push_back(p.first);
+        sorted.push_back(p.second);
+    }
+
+    // Breadth first, so that each node's children are appended together.
+    Node root = {0, 0, 0, 0, (uint32_t)sorted.size()};
+    nodes.push_back(root);
+    std::vector<std::pair<uint32_t, size_t>> queue(1, std::make_pair(0, 0));
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        uint32_t id = queue[head].first;
+        size_t depth = queue[head].second;
+        uint32_t lo = nodes[id].lo, hi = nodes[id].hi;
+        // Names that end here sort before the ones that go on.
+        while (lo < hi && folded[lo].size() == depth)
+            lo++;
+        nodes[id].child = (uint32_t)nodes.size();
+        for (uint32_t i = lo; i < hi;)
+        {
+            char c = folded[i][depth];
+            uint32_t j = i;
+            while (j < hi && folded[j][depth] == c)
+                j++;
+            Node n = {c, 0, 0, i, j};
+            queue.push_back(std::make_pair((uint32_t)nodes.size(), depth + 1));
+            nodes.push_back(n);
+            i = j;
+        }
+        nodes[id].children = (uint32_t)nodes.size() - nodes[id].child;
+    }
+}
+
+std::string NameIndex::find(const std::string &name) const
+{
+    auto it = by_folded.find(fold_name(name));
+    return it == by_folded.end() ? "" : sorted[it->second];
+}
+
+std::vector<std::string> NameIndex::complete(const std::string &prefix,
+                                             size_t limit) const
+{
+    std::vector<std::string> out;
+    if (nodes.empty())
+        return out;
+    uint32_t at = 0;
+    for (char c : fold_name(prefix))
+    {
+        // A leaf's child is one past the end, so take it as a pointer.
+        const Node *first = nodes.data() + nodes[at].child;
+        const Node *last = first + nodes[at].children;
+        const Node *n = std::lower_bound(
+            first, last, c,
+            // Labels are ordered as std::string orders them: unsigned.
+            [](const Node &x, char v) {
+                return (unsigned char)x.label < (unsigned char)v;
+            });
+        if (n == last || n->label != c)
+            return out;
+        at = (uint32_t)(n - nodes.data());
+    }
+    for (uint32_t i = nodes[at].lo; i < nodes[at].hi && out.size() < limit;
+         i++)
+        out.push_back(sorted[i]);
+    return out;
+}
@@ -0,0 +1,324 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "position.h"
+
+#include "app.h"
+#include "game.h"
+
+static uint8_t clamp_u8(int v, const char *what)
+{
+    if (v < 0 || v > 255)
+        throw std::runtime_error(std::string("position: ") + what +
+                                 " out of range");
+    return (uint8_t)v;
+}
+
+static int code_number(const std::string &code)
+{
+    int n = 0;
+    for (size_t i = 1; i < code.size(); ++i)
+    {
+        if (!std::isdigit((unsigned char)code[i]))
+            return -1;
+        n = n * 10 + (code[i] - '0');
+    }
+    return (code.size() > 1) ? n : -1;
+}
+
+static std::string code_string(const PackedShip &s)
+{
+    return std::string(1, (char)s.type) + std::to_string(s.num);
+}
+
+int Position::add_ship(const PackedShip &s)
+{
+    if (nships >= KH_MAX_SHIPS)
+        throw std::runtime_error("position: too many ships");
+    int i = nships++;
+    ships[i] = s;
+    if (s.carrier == KH_NO_SHIP && s.region != KH_NO_REGION)
+        occ[s.owner].set(s.region);
+    return i;
+}
+
+void Position::refresh_occupancy(int side, int region)
+{
+    for (int i = 0; i < nships; i++)
+    {
+        if (ships[i].owner == side && ships[i].carrier == KH_NO_SHIP &&
+            ships[i].region == region)
+        {
+            occ[side].set(region);
+            return;
+        }
+    }
+    occ[side].reset(region);
+}
+
+// Removes every ship in 'region', including anything racked in a removed
+// carrier, and compacts the ship array (carrier indices are remapped).
+void Position::remove_ships_at(int region)
+{
+    uint8_t remap[KH_MAX_SHIPS];
+    int n = 0;
+    for (int i = 0; i < nships; i++)
+    {
+        if (region_of(i) == region)
+            remap[i] = KH_NO_SHIP;
+        else
+            remap[i] = (uint8_t)n++;
+    }
+    for (int i = 0; i < nships; i++)
+    {
+        if (remap[i] == KH_NO_SHIP)
+            continue;
+        PackedShip s = ships[i];
+        if (s.carrier != KH_NO_SHIP)
+            s.carrier = remap[s.carrier];
+        ships[remap[i]] = s;
+    }
+    nships = (uint8_t)n;
+    occ[0].reset(region);
+    occ[1].reset(region);
+}
+
+Position position_from_rows(const GameMap &m, const GameState &s,
+                            const std::vector<ShipRow> &shipsA,
+                            const std::vector<ShipRow> &shipsB)
+{
+    if (m.size() > KH_MAX_REGIONS)
+        throw std::runtime_error("position: map too large");
+
+    Position p;
+    p.round = (uint16_t)std::max(1, s.round);
+    p.to_move = (s.active_player == "B") ? 1 : 0;
+    p.vp[0] = clamp_u8(s.vpA, "vp");
+    p.vp[1] = clamp_u8(s.vpB, "vp");
+    p.vp_need = clamp_u8(vp_needed(s.scenario), "vp");
+    p.winner = s.game_over && !s.winner.empty() ? s.winner[0] : 0;
+
+    const std::vector<ShipRow> *lists[2] = {&shipsA, &shipsB};
+    std::map<std::string, int> index[2];
+
+    for (int side = 0; side < 2; side++)
+    {
+        for (auto &r : *lists[side])
+        {
+            int num = code_number(r.code);
+            if (num < 0)
+                throw std::runtime_error("position: bad ship code " + r.code);
+            PackedShip ps;
+            std::memset(&ps, 0, sizeof(ps));
+            ps.owner = (uint8_t)side;
+            ps.type = (uint8_t)r.attr.type;
+            ps.num = clamp_u8(num, "ship code");
+            ps.tech = clamp_u8(r.attr.tech, "tech");
+            ps.PD = clamp_u8(r.attr.PD, "PD");
+            ps.B = clamp_u8(r.attr.B, "B");
+            ps.S = clamp_u8(r.attr.S, "S");
+            ps.T = clamp_u8(r.attr.T, "T");
+            ps.M = clamp_u8(r.attr.M, "M");
+            ps.SR = clamp_u8(r.attr.SR, "SR");
+            ps.carrier = KH_NO_SHIP;
+            ps.region = KH_NO_REGION;
+            if (r.racked_in.empty() && !r.at_system.empty())
+            {
+                int reg = m.region_of_name(r.at_system);
+                if (reg >= 0)
+                    ps.region = (uint16_t)reg;
+            }
+            // carriers are linked in a second pass
+            index[side][r.code] = p.add_ship(ps);
+        }
+    }
+
+    for (int side = 0; side < 2; side++)
+    {
+        for (auto &r : *lists[side])
+        {
+            if (r.racked_in.empty())
+                continue;
+            auto it = index[side].find(r.racked_in);
+            if (it != index[side].end())
+                p.ships[index[side][r.code]].carrier = (uint8_t)it->second;
+        }
+    }
+    return p;
+}
+
+// Writes locations back onto the DB-backed rows: ships missing from the
+// position are erased, ships new to the position are appended.
+void position_to_rows(const GameMap &m, const Position &p,
+                      std::vector<ShipRow> &shipsA,
+                      std::vector<ShipRow> &shipsB)
+{
+    std::vector<ShipRow> *lists[2] = {&shipsA, &shipsB};
+    std::map<std::string, int> index[2];
+    for (int i = 0; i < p.nships; i++)
+        index[p.ships[i].owner][code_string(p.ships[i])] = i;
+
+    for (int side = 0; side < 2; side++)
+    {
+        std::vector<ShipRow> out;
+        std::set<std::string> seen;
+        for (auto &r : *lists[side])
+        {
+            auto it = index[side].find(r.code);
+            if (it == index[side].end())
+                continue;
+            out.push_back(r);
+            seen.insert(r.code);
+        }
+        for (auto &kv : index[side])
+        {
+            if (seen.count(kv.first))
+                continue;
+            const PackedShip &ps = p.ships[kv.second];
+            ShipRow r;
+            r.code = kv.first;
+            r.name = (ps.type == 'W') ? "WarpShip" : "SystemShip";
+            r.attr.type = (char)ps.type;
+            r.attr.tech = ps.tech;
+            r.attr.PD = ps.PD;
+            r.attr.B = ps.B;
+            r.attr.S = ps.S;
+            r.attr.T = ps.T;
+            r.attr.M = ps.M;
+            r.attr.SR = ps.SR;
+            out.push_back(r);
+        }
+        for (auto &r : out)
+        {
+            const PackedShip &ps = p.ships[index[side][r.code]];
+            int reg = p.region_of(index[side][r.code]);
+            r.racked_in = (ps.carrier != KH_NO_SHIP)
+                              ? code_string(p.ships[ps.carrier])
+                              : "";
+            r.at_system = (reg != KH_NO_REGION && ps.carrier == KH_NO_SHIP)
+                              ? m.names[reg]
+                              : "";
+            r.at_hex = (reg != KH_NO_REGION) ? m.hexes[reg] : "";
+        }
+        *lists[side] = out;
+    }
+}
+
+void generate_moves(const GameMap &m, const Position &p,
+                    std::vector<Move> &out)
+{
+    out.clear();
+    if (p.winner)
+        return;
+
+    Move hold;
+    hold.ship = KH_NO_SHIP;
+    hold.to = KH_NO_REGION;
+    out.push_back(hold);
+
+    for (int i = 0; i < p.nships; i++)
+    {
+        const PackedShip &s = p.ships[i];
+        if (s.owner != p.to_move || s.type != 'W' ||
+            s.carrier != KH_NO_SHIP || s.region == KH_NO_REGION)
+            continue;
+        for (const int *n = m.neighbors_begin(s.region);
+             n != m.neighbors_end(s.region); ++n)
+        {
+            Move mv;
+            mv.ship = (uint8_t)i;
+            mv.to = (uint16_t)*n;
+            out.push_back(mv);
+        }
+    }
+}
+
+// Applies one ply: movement, then conflict resolution in the destination
+// (RULES.md 7.3: every fleet in a contested region is removed), then the
+// start-of-turn VP count for the side that moves next.
+void make_move(const GameMap &m, Position &p, const Move &mv)
+{
+    int me = p.to_move;
+    int enemy = 1 - me;
+
+    if (mv.ship != KH_NO_SHIP)
+    {
+        PackedShip &s = p.ships[mv.ship];
+        int from = s.region;
+        s.region = mv.to;
+        p.refresh_occupancy(me, from);
+        p.occ[me].set(mv.to);
+        if (p.occ[enemy].test(mv.to))
+            p.remove_ships_at(mv.to);
+    }
+
+    p.to_move = (uint8_t)enemy;
+    if (enemy == 0)
+        p.round++;
+
+    int gain = 0;
+    for (auto b : m.bases[me])
+    {
+        if (p.occ[enemy].test(b))
+            gain++;
+    }
+    p.vp[enemy] = (uint8_t)std::min(255, p.vp[enemy] + gain);
+    if (p.vp[enemy] >= p.vp_need)
+        p.winner = enemy ? 'B' : 'A';
+}
+
+static uint64_t perft_rec(const GameMap &m, const Position &p, int depth,
+                          std::vector<std::vector<Move>> &stack)
+{
+    std::vector<Move> &moves = stack[depth];
+    generate_moves(m, p, moves);
+    if (depth == 1)
+        return moves.size();
+
+    uint64_t nodes = 0;
+    for (size_t i = 0; i < moves.size(); i++)
+    {
+        Position child = p;
+        make_move(m, child, moves[i]);
+        nodes += perft_rec(m, child, depth - 1, stack);
+    }
+    return nodes;
+}
+
+// Counts leaf nodes of the move tree 'depth' plies deep.
+uint64_t perft(const GameMap &m, const Position &p, int depth)
+{
+    if (depth <= 0)
+        return 1;
+    std::vector<std::vector<Move>> stack(depth + 1);
+    return perft_rec(m, p, depth, stack);
+}
@@ -0,0 +1,469 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "scan.h"
+
+#include "app.h"
+#include "game.h"
+
+#include <mutex>
+
+// Within a process a game's commands run on its home shard thread (see
+// shard.h), so a ScanState is only touched by that thread; the registry
+// itself is shared so a draining worker can write out what is pending.
+// With --workers, other processes keep their own states for the same game,
+// and scan_begin() notices when one of them moved the game on.
+static std::mutex registry_mu;
+
+static std::map<int, ScanState> &scan_registry()
+{
+    static std::map<int, ScanState> r;
+    return r;
+}
+
+// Sightings from committed commands not yet written when their ScanState
+// was dropped; the next load() takes them back.
+class CarriedSightings
+{
+  public:
+    std::string turn;
+    std::map<std::string, Sighting> seen[2];
+};
+
+static std::map<int, CarriedSightings> carried; // under registry_mu
+
+static ScanState &scan_state(Db *db, int game_id)
+{
+    ScanState *st;
+    {
+        std::lock_guard<std::mutex> g(registry_mu);
+        st = &scan_registry()[game_id];
+    }
+    if (!st->loaded)
+        st->load(db, game_id);
+    return *st;
+}
+
+// Drops the state of 'game_id', keeping what its last commit left unwritten.
+static void drop_state(int game_id)
+{
+    std::lock_guard<std::mutex> g(registry_mu);
+    auto it = scan_registry().find(game_id);
+    if (it == scan_registry().end())
+        return;
+    ScanState &st = it->second;
+    if (!st.committed[0].empty() || !st.committed[1].empty())
+    {
+        CarriedSightings &c = carried[game_id];
+        c.turn = st.turn;
+        for (int sd = 0; sd < 2; sd++)
+            for (auto &kv : st.committed[sd])
+                c.seen[sd][kv.first] = kv.second;
+    }
+    scan_registry().erase(it);
+}
+
+static int side_of(char owner)
+{
+    return (owner == 'B') ? 1 : 0;
+}
+
+// Full rebuild from the DB; afterwards only move()/remove() touch the state.
+void ScanState::load(Db *db, int game_id)
+{
+    map = game_map(db, game_id, -1);
+    int n = map->size();
+    for (int sd = 0; sd < 2; sd++)
+    {
+        ships[sd].clear();
+        at[sd].assign(n, std::set<std::string>());
+        cover[sd].assign(n, 0);
+        seen[sd].clear();
+        dirty[sd].clear();
+        committed[sd].clear();
+    }
+
+    auto rows = db->query("SELECT observer_owner,ship_code,ship_name,"
+                          "ship_type,at_system,last_seen_turn FROM sightings "
+                          "WHERE game_id=" +
+                          std::to_string(game_id));
+    for (auto &r : rows)
+    {
+        Sighting sg;
+        sg.code = r[1];
+        sg.name = r[2];
+        sg.type = r[3].empty() ? 'W' : r[3][0];
+        sg.at_system = r[4];
+        sg.last_seen_turn = r[5];
+        seen[side_of(r[0].empty() ? 'A' : r[0][0])][sg.code] = sg;
+    }
+
+    loaded = true;
+    for (int sd = 0; sd < 2; sd++)
+    {
+        for (auto &sh : load_ships(db, game_id, sd ? 'B' : 'A'))
+        {
+            Tracked t;
+            t.name = sh.name;
+            t.type = sh.attr.type;
+            t.region = -1;
+            ships[sd][sh.code] = t;
+            // Racked ships ride unseen in their carrier and don't scan.
+            if (sh.racked_in.empty() && !sh.at_system.empty())
+                move(sd, sh.code, map->region_of_name(sh.at_system));
+        }
+    }
+
+    // Unwritten sightings of a dropped state, unless the ship is in view
+    // again now. They still count as committed.
+    CarriedSightings c;
+    {
+        std::lock_guard<std::mutex> g(registry_mu);
+        auto it = carried.find(game_id);
+        if (it != carried.end())
+        {
+            c = it->second;
+            carried.erase(it);
+        }
+    }
+    turn = c.turn;
+    for (int sd = 0; sd < 2; sd++)
+    {
+        for (auto &kv : c.seen[sd])
+        {
+            auto cur = seen[sd].find(kv.first);
+            if (cur != seen[sd].end() && cur->second.in_view)
+                continue;
+            seen[sd][kv.first] = kv.second;
+            dirty[sd].insert(kv.first);
+            committed[sd][kv.first] = kv.second;
+        }
+    }
+}
+
+void ScanState::observe(int observer, const std::string &code)
+{
+    const Tracked &t = ships[1 - observer][code];
+    Sighting &sg = seen[observer][code];
+    if (sg.in_view && sg.at_system == map->names[t.region])
+        return;
+    sg.code = code;
+    sg.name = t.name;
+    sg.type = t.type;
+    sg.at_system = map->names[t.region];
+    sg.in_view = true;
+    dirty[observer].insert(code);
+}
+
+void ScanState::cover_area(int owner, int region, int delta)
+{
+    auto touch = [&](int r) {
+        int before = cover[owner][r];
+        cover[owner][r] += delta;
+        if (before == 0 && cover[owner][r] > 0)
+        {
+            for (auto &code : at[1 - owner][r])
+                observe(owner, code);
+        }
+        else if (before > 0 && cover[owner][r] == 0)
+        {
+            for (auto &code : at[1 - owner][r])
+            {
+                seen[owner][code].in_view = false;
+                dirty[owner].insert(code);
+            }
+        }
+    };
+    touch(region);
+    for (const int *n = map->neighbors_begin(region);
+         n != map->neighbors_end(region); ++n)
+        touch(*n);
+}
+
+void ScanState::move(int owner, const std::string &code, int region)
+{
+    auto it = ships[owner].find(code);
+    if (it == ships[owner].end() || it->second.region == region)
+        return;
+
+    int old = it->second.region;
+    if (old >= 0)
+    {
+        at[owner][old].erase(code);
+        cover_area(owner, old, -1);
+    }
+    it->second.region = region;
+    if (region >= 0)
+    {
+        at[owner][region].insert(code);
+        cover_area(owner, region, +1);
+    }
+
+    // the mover as a subject of the other side's scan
+    int obs = 1 - owner;
+    if (region >= 0 && cover[obs][region] > 0)
+    {
+        observe(obs, code);
+    }
+    else
+    {
+        auto s = seen[obs].find(code);
+        if (s != seen[obs].end() && s->second.in_view)
+        {
+            s->second.in_view = false;
+            dirty[obs].insert(code);
+        }
+    }
+}
+
+void ScanState::remove(int owner, const std::string &code)
+{
+    move(owner, code, -1);
+    ships[owner].erase(code);
+}
+
+void scan_note_location(Db *db, int game_id, char owner,
+                        const std::string &code, const std::string &at_system)
+{
+    ScanState &st = scan_state(db, game_id);
+    int sd = side_of(owner);
+    if (!st.ships[sd].count(code))
+    {
+        ShipRow sh = load_ship(db, game_id, owner, code);
+        ScanState::Tracked t;
+        t.name = sh.name;
+        t.type = sh.attr.type;
+        t.region = -1;
+        st.ships[sd][code] = t;
+    }
+    st.move(sd, code,
+            at_system.empty() ? -1 : st.map->region_of_name(at_system));
+}
+
+void scan_note_removed(Db *db, int game_id, char owner,
+                       const std::string &code)
+{
+    scan_state(db, game_id).remove(side_of(owner), code);
+}
+
+void scan_reset(Db *db, int game_id)
+{
+    db->exec("DELETE FROM sightings WHERE game_id=" +
+             std::to_string(game_id));
+    std::lock_guard<std::mutex> g(registry_mu);
+    scan_registry().erase(game_id);
+    carried.erase(game_id);
+}
+
+// Drops the in-memory state, e.g. after its writes were rolled back; it is
+// rebuilt from the database on next use.
+void scan_forget(int game_id)
+{
+    drop_state(game_id);
+}
+
+// A command is starting from 'version' of the game. State kept from any
+// other version is stale (another process changed the game) and is dropped.
+void scan_begin(int game_id, int version)
+{
+    bool stale;
+    {
+        std::lock_guard<std::mutex> g(registry_mu);
+        auto it = scan_registry().find(game_id);
+        stale = it != scan_registry().end() && it->second.version != version;
+    }
+    if (stale)
+        drop_state(game_id);
+}
+
+// The command's changes were committed as 'version', in 'turn'. The state
+// is loaded if the command didn't need it, so scan_seen() can answer.
+void scan_commit(Db *db, int game_id, int version, const std::string &turn)
+{
+    ScanState &st = scan_state(db, game_id);
+    st.version = version;
+    st.turn = turn;
+    for (int sd = 0; sd < 2; sd++)
+    {
+        st.committed[sd].clear();
+        for (auto &code : st.dirty[sd])
+            st.committed[sd][code] = st.seen[sd][code];
+    }
+}
+
+// What 'side' has seen of the enemy, for the snapshot of the version just
+// committed. Sightings in view or not yet written are as of this turn.
+SeenShipsPtr scan_seen(int game_id, int side)
+{
+    ScanState *st;
+    {
+        std::lock_guard<std::mutex> g(registry_mu);
+        auto it = scan_registry().find(game_id);
+        if (it == scan_registry().end() || !it->second.loaded)
+            return SeenShipsPtr();
+        st = &it->second;
+    }
+    std::shared_ptr<std::vector<SeenShip>> out =
+        std::make_shared<std::vector<SeenShip>>();
+    for (auto &kv : st->seen[side])
+    {
+        const Sighting &sg = kv.second;
+        SeenShip v;
+        v.code = sg.code;
+        v.name = sg.name;
+        v.type = std::string(1, sg.type);
+        v.at_system = sg.at_system;
+        v.seen = (sg.in_view || st->dirty[side].count(kv.first))
+                     ? st->turn
+                     : sg.last_seen_turn;
+        out->push_back(v);
+    }
+    return out;
+}
+
+// Upserts 'rows' (observer side -> sightings) as seen in 'turn'.
+static void write_sightings(Db *db, int game_id, const std::string &turn,
+                            std::map<std::string, Sighting> *rows[2])
+{
+    std::ostringstream q;
+    q << "INSERT INTO sightings(game_id,observer_owner,subject_owner,"
+         "ship_code,ship_name,ship_type,at_system,last_seen_turn) VALUES";
+    int n = 0;
+    for (int sd = 0; sd < 2; sd++)
+    {
+        for (auto &kv : *rows[sd])
+        {
+            Sighting &sg = kv.second;
+            sg.last_seen_turn = turn;
+            q << (n++ ? "," : "") << "(" << game_id << ",'"
+              << (sd ? 'B' : 'A') << "','" << (sd ? 'A' : 'B') << "','"
+              << db->esc(sg.code) << "','" << db->esc(sg.name) << "','"
+              << sg.type << "','" << db->esc(sg.at_system) << "','"
+              << db->esc(turn) << "')";
+        }
+    }
+    if (n == 0)
+        return;
+    q << " ON DUPLICATE KEY UPDATE ship_name=VALUES(ship_name),"
+         "ship_type=VALUES(ship_type),at_system=VALUES(at_system),"
+         "last_seen_turn=VALUES(last_seen_turn)";
+    db->exec(q.str());
+}
+
+// Writes every sighting changed since the last flush in a single upsert.
+void scan_flush(Db *db, int game_id, const std::string &turn)
+{
+    ScanState *st;
+    {
+        std::lock_guard<std::mutex> g(registry_mu);
+        auto it = scan_registry().find(game_id);
+        if (it == scan_registry().end() || !it->second.loaded)
+            return;
+        st = &it->second;
+    }
+
+    std::map<std::string, Sighting> rows[2];
+    for (int sd = 0; sd < 2; sd++)
+    {
+        for (auto &code : st->dirty[sd])
+        {
+            st->seen[sd][code].last_seen_turn = turn;
+            rows[sd][code] = st->seen[sd][code];
+        }
+        st->dirty[sd].clear();
+    }
+    std::map<std::string, Sighting> *p[2] = {&rows[0], &rows[1]};
+    write_sightings(db, game_id, turn, p);
+}
+
+// Whether scan_flush_all() has anything to write.
+bool scan_pending()
+{
+    std::lock_guard<std::mutex> g(registry_mu);
+    if (!carried.empty())
+        return true;
+    for (auto &kv : scan_registry())
+        if (!kv.second.committed[0].empty() || !kv.second.committed[1].empty())
+            return true;
+    return false;
+}
+
+// Writes what committed commands saw but no turn change has written yet,
+// for every game. Only call once no command is running (a drained worker).
+void scan_flush_all(Db *db)
+{
+    std::lock_guard<std::mutex> g(registry_mu);
+    for (auto &kv : scan_registry())
+    {
+        ScanState &st = kv.second;
+        std::map<std::string, Sighting> *p[2] = {&st.committed[0],
+                                                 &st.committed[1]};
+        write_sightings(db, kv.first, st.turn, p);
+        for (int sd = 0; sd < 2; sd++)
+        {
+            for (auto &c : st.committed[sd])
+                st.dirty[sd].erase(c.first);
+            st.committed[sd].clear();
+        }
+    }
+    for (auto &kv : carried)
+    {
+        std::map<std::string, Sighting> *p[2] = {&kv.second.seen[0],
+                                                 &kv.second.seen[1]};
+        write_sightings(db, kv.first, kv.second.turn, p);
+    }
+    carried.clear();
+}
+
+std::string scan_report(Db *db, int game_id, char observer)
+{
+    ScanState &st = scan_state(db, game_id);
+    int sd = side_of(observer);
+    std::ostringstream o;
+    o << "Scan:\n";
+    if (st.seen[sd].empty())
+    {
+        o << "  (no enemy ships sighted)\n";
+        return o.str();
+    }
+    for (auto &kv : st.seen[sd])
+    {
+        const Sighting &sg = kv.second;
+        o << "  Red: " << sg.name << " - " << sg.code << " @ " << sg.at_system;
+        if (sg.in_view)
+            o << " (in view)";
+        else
+            o << " (last seen " << sg.last_seen_turn << ")";
+        o << "\n";
+    }
+    return o.str();
+}
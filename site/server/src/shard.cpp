@@ -0,0 +1,375 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "shard.h"
+
+#include "app.h"
+#include "comms.h"
+#include "static_files.h"
+#include "util.h"
+
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <mysql/mysql.h>
+#include <sched.h>
+
+// Queue limits per class (KH_CLASS_*), and the order classes are served in.
+static const int class_limit[KH_CLASSES] = {256, 512, 128, 64};
+static const int class_order[KH_CLASSES] = {KH_CLASS_COMMAND, KH_CLASS_INTAKE,
+                                            KH_CLASS_STATE, KH_CLASS_EVENTS};
+
+// State and event reads are served from the game's published snapshot by
+// whichever shard reads them; everything else runs on the home shard.
+static int request_class(const HttpRequest &req)
+{
+    if (!starts_with(req.path, "/api/"))
+        return KH_CLASS_EVENTS; // static files share the lowest class
+    if (req.method == "GET" &&
+        (req.path == "/api/state" || req.path == "/api/view" ||
+         req.path == "/api/complete"))
+        return KH_CLASS_STATE;
+    if (req.method == "GET" &&
+        (req.path == "/api/events" || req.path == "/api/map" ||
+         req.path == "/api/tile"))
+        return KH_CLASS_EVENTS;
+    return KH_CLASS_COMMAND;
+}
+
+static void refuse(ShardPool *pool, ShardJob *j, int status,
+                   int retry_after, const std::string &why)
+{
+    HttpResponse resp;
+    resp.status = status;
+    resp.retry_after = retry_after;
+    resp.body = json_error(why);
+    send_response(j->fd, resp);
+    pool->release(j);
+}
+
+// Bound on remembered token -> game bindings per shard; the map is simply
+// dropped when it fills up.
+#define KH_SHARD_TOKEN_CACHE 4096
+
+Mailbox::Mailbox() : head(&stub), tail(&stub), stub(-1, HttpRequest())
+{
+}
+
+void Mailbox::push(ShardJob *j)
+{
+    j->next.store(NULL, std::memory_order_relaxed);
+    ShardJob *prev = head.exchange(j, std::memory_order_acq_rel);
+    prev->next.store(j, std::memory_order_release);
+}
+
+// Returns NULL when empty, or when a producer is between its exchange and
+// its link store; the caller retries in that case.
+ShardJob *Mailbox::pop()
+{
+    ShardJob *t = tail;
+    ShardJob *n = t->next.load(std::memory_order_acquire);
+    if (t == &stub)
+    {
+        if (!n)
+            return NULL;
+        tail = n;
+        t = n;
+        n = n->next.load(std::memory_order_acquire);
+    }
+    if (n)
+    {
+        tail = n;
+        return t;
+    }
+    if (t != head.load(std::memory_order_acquire))
+        return NULL;
+    push(&stub);
+    n = t->next.load(std::memory_order_acquire);
+    if (n)
+    {
+        tail = n;
+        return t;
+    }
+    return NULL;
+}
+
+Shard::Shard(ShardPool *pool_, int index_) : pool(pool_), index(index_)
+{
+    for (int c = 0; c < KH_CLASSES; c++)
+        depth[c] = 0;
+    sem_init(&wake, 0, 0);
+}
+
+Shard::~Shard()
+{
+    sem_destroy(&wake);
+}
+
+void Shard::start(const Args &args)
+{
+    db.connect(args.dbhost, args.dbuser, args.dbpass, args.dbname);
+    th = std::thread(&Shard::run, this);
+    th.detach();
+}
+
+// Queues 'j' as class 'cls'; false (and nothing queued) when that queue is
+// full, in which case the caller still owns the job.
+bool Shard::post(ShardJob *j, int cls)
+{
+    if (depth[cls].fetch_add(1, std::memory_order_relaxed) >=
+        class_limit[cls])
+    {
+        depth[cls].fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    box[cls].push(j);
+    sem_post(&wake);
+    return true;
+}
+
+void Shard::run()
+{
+    mysql_thread_init();
+    while (true)
+    {
+        if (sem_wait(&wake) != 0)
+            continue;
+        // One job per wake-up, from the highest class that has one. A push
+        // may still be completing, so keep looking until it shows up.
+        ShardJob *j = NULL;
+        int cls = 0;
+        while (!j)
+        {
+            for (int i = 0; i < KH_CLASSES && !j; i++)
+            {
+                cls = class_order[i];
+                j = box[cls].pop();
+            }
+            if (!j)
+                sched_yield();
+        }
+        depth[cls].fetch_sub(1, std::memory_order_relaxed);
+        if (cls == KH_CLASS_INTAKE)
+            admit(j);
+        else
+            handle(j);
+    }
+}
+
+// Routes a new request: applies its token's rate limit and queues it by
+// class, commands on the game's home shard and reads here.
+void Shard::admit(ShardJob *j)
+{
+    int cls;
+    try
+    {
+        static_files().map_api(j->req);
+        j->game = game_for(j->req);
+        cls = request_class(j->req);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "[%s] shard %d: %s\n", now_iso().c_str(), index,
+                     e.what());
+        ::close(j->fd);
+        pool->release(j);
+        return;
+    }
+
+    int retry_after = 0;
+    if (!pool->allow(pick_bearer(&j->req), retry_after))
+    {
+        refuse(pool, j, 429, retry_after, "rate limit exceeded");
+        return;
+    }
+
+    Shard &to = (cls == KH_CLASS_COMMAND && j->game > 0) ? pool->home(j->game)
+                                                         : *this;
+    if (!to.post(j, cls))
+        refuse(pool, j, 503, 1, "server busy");
+}
+
+void Shard::handle(ShardJob *j)
+{
+    try
+    {
+        serve_request(j->fd, j->req, &db);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "[%s] shard %d: %s\n", now_iso().c_str(), index,
+                     e.what());
+        ::close(j->fd);
+    }
+    pool->release(j);
+}
+
+// Game of the session behind the request's bearer token; 0 (served by
+// whichever shard read it) when there is none. Bindings never change once made.
+int Shard::game_for(const HttpRequest &req)
+{
+    std::string tok = pick_bearer(&req);
+    if (tok.empty())
+        return 0;
+
+    auto it = token_game.find(tok);
+    if (it != token_game.end())
+        return it->second;
+
+    int g = session_game(&db, tok);
+    if (g <= 0)
+        return 0;
+    if (token_game.size() >= KH_SHARD_TOKEN_CACHE)
+        token_game.clear();
+    token_game[tok] = g;
+    return g;
+}
+
+ShardPool::ShardPool() : rr(0), inflight(0)
+{
+}
+
+ShardPool::~ShardPool()
+{
+    // Shard threads are detached and run for the life of the process.
+}
+
+void ShardPool::start(int n, const Args &args)
+{
+    buckets.configure(args.rate, 2.0 * args.rate);
+    if (n <= 0)
+        n = (int)std::thread::hardware_concurrency();
+    if (n <= 0)
+        n = 1;
+    for (int i = 0; i < n; i++)
+        shards.push_back(new Shard(this, i));
+    for (int i = 0; i < n; i++)
+        shards[i]->start(args);
+}
+
+void ShardPool::submit(int fd, const HttpRequest &req)
+{
+    unsigned i = rr.fetch_add(1, std::memory_order_relaxed);
+    ShardJob *j = new ShardJob(fd, req);
+    inflight.fetch_add(1, std::memory_order_relaxed);
+    if (!shards[i % shards.size()]->post(j, KH_CLASS_INTAKE))
+        refuse(this, j, 503, 1, "server busy");
+}
+
+// Called once per submitted request when it has been answered.
+void ShardPool::release(ShardJob *j)
+{
+    delete j;
+    inflight.fetch_sub(1, std::memory_order_release);
+}
+
+// Waits (up to 'seconds') until every submitted request is answered.
+bool ShardPool::drain(int seconds)
+{
+    for (int waited = 0; waited < seconds * 20; waited++)
+    {
+        if (inflight.load(std::memory_order_acquire) == 0)
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    return inflight.load(std::memory_order_acquire) == 0;
+}
+
+bool ShardPool::allow(const std::string &token, int &retry_after)
+{
+    if (token.empty())
+        return true;
+    return buckets.take(token, retry_after);
+}
+
+TokenBuckets::TokenBuckets() : rate(0), burst(0)
+{
+}
+
+// A rate of 0 turns limiting off.
+void TokenBuckets::configure(double rate_, double burst_)
+{
+    rate = rate_;
+    burst = burst_;
+}
+
+bool TokenBuckets::take(const std::string &token, int &retry_after)
+{
+    if (rate <= 0)
+        return true;
+
+    double now = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now().time_since_epoch())
+                     .count();
+    Stripe &st = stripes[std::hash<std::string>()(token) % KH_BUCKET_STRIPES];
+    std::lock_guard<std::mutex> g(st.mu);
+
+    // Idle buckets are full again; forget them rather than grow forever.
+    if (st.b.size() > 1024)
+    {
+        for (auto it = st.b.begin(); it != st.b.end();)
+        {
+            if (it->second.tokens + (now - it->second.stamp) * rate >= burst)
+                it = st.b.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    auto it = st.b.find(token);
+    if (it == st.b.end())
+    {
+        Bucket fresh;
+        fresh.tokens = burst;
+        fresh.stamp = now;
+        it = st.b.insert(std::make_pair(token, fresh)).first;
+    }
+    Bucket &b = it->second;
+    b.tokens = std::min(burst, b.tokens + (now - b.stamp) * rate);
+    b.stamp = now;
+    if (b.tokens >= 1.0)
+    {
+        b.tokens -= 1.0;
+        return true;
+    }
+    retry_after = (int)std::ceil((1.0 - b.tokens) / rate);
+    if (retry_after < 1)
+        retry_after = 1;
+    return false;
+}
+
+Shard &ShardPool::home(int game_id)
+{
+    if (game_id < 0)
+        game_id = 0;
+    return *shards[(unsigned)game_id % shards.size()];
+}
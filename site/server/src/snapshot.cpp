@@ -0,0 +1,197 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "snapshot.h"
+
+#include <atomic>
+
+#include "app.h"
+#include "flight.h"
+#include "game.h"
+
+// Slots live in fixed-size chunks allocated on first use, so a slot never
+// moves and lookups need no lock. Games past the last chunk are not cached.
+#define KH_SNAPSHOT_CHUNK 1024
+#define KH_SNAPSHOT_CHUNKS 1024
+
+struct SnapshotChunk
+{
+    SnapshotPtr slot[KH_SNAPSHOT_CHUNK];
+};
+
+static std::atomic<SnapshotChunk *> chunks[KH_SNAPSHOT_CHUNKS];
+
+static SnapshotPtr *snapshot_slot(int game_id)
+{
+    if (game_id <= 0 || game_id >= KH_SNAPSHOT_CHUNK * KH_SNAPSHOT_CHUNKS)
+        return NULL;
+    std::atomic<SnapshotChunk *> &c = chunks[game_id / KH_SNAPSHOT_CHUNK];
+    SnapshotChunk *p = c.load(std::memory_order_acquire);
+    if (!p)
+    {
+        SnapshotChunk *n = new SnapshotChunk();
+        if (c.compare_exchange_strong(p, n, std::memory_order_acq_rel))
+            p = n;
+        else
+            delete n;
+    }
+    return &p->slot[game_id % KH_SNAPSHOT_CHUNK];
+}
+
+void EventRing::push(const EventRow &e)
+{
+    std::atomic_store(&slot[e.seq % KH_EVENT_RING],
+                      EventPtr(std::make_shared<EventRow>(e)));
+}
+
+EventPtr EventRing::at(int seq) const
+{
+    if (seq <= 0)
+        return EventPtr();
+    EventPtr e = std::atomic_load(&slot[seq % KH_EVENT_RING]);
+    if (!e || e->seq != seq)
+        return EventPtr();
+    return e;
+}
+
+// 'prev', if given, is the snapshot being replaced: its state joins the
+// history window and only events newer than it are read and appended to
+// its ring.
+SnapshotPtr build_snapshot(Db *db, int game_id, const SnapshotPtr &prev)
+{
+    std::shared_ptr<GameSnapshot> snap = std::make_shared<GameSnapshot>();
+    snap->state = load_game(db, game_id);
+
+    std::string q = "SELECT seq,command_text,result_text,created_at FROM "
+                    "game_events WHERE game_id=" +
+                    std::to_string(game_id);
+    if (prev && prev->events)
+    {
+        snap->events = prev->events;
+        snap->last_seq = prev->last_seq;
+        q += " AND seq>" + std::to_string(prev->last_seq) + " ORDER BY seq";
+    }
+    else
+    {
+        snap->events = std::make_shared<EventRing>();
+        q = "SELECT * FROM (" + q + " ORDER BY seq DESC LIMIT " +
+            std::to_string(KH_EVENT_RING) + ") t ORDER BY seq";
+    }
+    for (auto &r : db->query(q))
+    {
+        EventRow e;
+        e.seq = std::atoi(r[0].c_str());
+        e.cmd = r[1];
+        e.result = r[2];
+        e.ts = r[3];
+        snap->events->push(e);
+        snap->last_seq = e.seq;
+    }
+
+    if (prev && prev->state.version < snap->state.version)
+    {
+        size_t n = prev->history.size();
+        size_t from = (n >= KH_SNAPSHOT_HISTORY) ? n - KH_SNAPSHOT_HISTORY + 1
+                                                 : 0;
+        snap->history.assign(prev->history.begin() + from,
+                             prev->history.end());
+        snap->history.push_back(prev->state);
+    }
+    return snap;
+}
+
+// The state at 'version' if it is still in the window, else NULL.
+const GameState *snapshot_version(const GameSnapshot &snap, int version)
+{
+    if (snap.state.version == version)
+        return &snap.state;
+    for (size_t i = 0; i < snap.history.size(); i++)
+    {
+        if (snap.history[i].version == version)
+            return &snap.history[i];
+    }
+    return NULL;
+}
+
+// Installs 'snap' unless a newer version is already in place; readers may
+// publish too when they find no snapshot, and must never roll one back.
+void publish_snapshot(int game_id, const SnapshotPtr &snap)
+{
+    SnapshotPtr *slot = snapshot_slot(game_id);
+    if (!slot)
+        return;
+    SnapshotPtr cur = std::atomic_load(slot);
+    while (!cur || cur->state.version < snap->state.version)
+    {
+        if (std::atomic_compare_exchange_weak(slot, &cur, snap))
+            break;
+    }
+}
+
+SnapshotPtr current_snapshot(int game_id)
+{
+    SnapshotPtr *slot = snapshot_slot(game_id);
+    if (!slot)
+        return SnapshotPtr();
+    return std::atomic_load(slot);
+}
+
+static std::atomic<bool> check_versions(false);
+
+// When other processes write the same games, a snapshot can fall behind
+// without this process knowing; readers then confirm its version first.
+void snapshot_check_versions(bool on)
+{
+    check_versions = on;
+}
+
+SnapshotPtr game_snapshot(Db *db, int game_id)
+{
+    SnapshotPtr cur = current_snapshot(game_id);
+    if (cur && check_versions)
+    {
+        auto r = db->query("SELECT version FROM games WHERE id=" +
+                           std::to_string(game_id));
+        if (!r.empty() && std::atoi(r[0][0].c_str()) != cur->state.version)
+            cur.reset();
+    }
+    if (cur)
+        return cur;
+
+    // Readers that all find the game unloaded (or stale) share one build.
+    static SingleFlight<GameSnapshot> flight;
+    return flight.run(std::to_string(game_id), [&]() {
+        SnapshotPtr snap = build_snapshot(db, game_id);
+        publish_snapshot(game_id, snap);
+        return snap;
+    });
+}
@@ -0,0 +1,106 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "spatial.h"
+
+#include "app.h"
+
+int HexGrid::cell_of(int v) const
+{
+    // Floor division, so that negative coordinates get cells of their own.
+    return (v >= 0) ? v / cell : -((-v - 1) / cell) - 1;
+}
+
+long long HexGrid::key(int cq, int cr)
+{
+    return ((long long)cq << 32) ^ (unsigned int)cr;
+}
+
+void HexGrid::insert(int item, int q0, int r0, int q1, int r1)
+{
+    if (q0 > q1)
+        std::swap(q0, q1);
+    if (r0 > r1)
+        std::swap(r0, r1);
+    if (boxes.empty())
+    {
+        min_q = q0;
+        min_r = r0;
+        max_q = q1;
+        max_r = r1;
+    }
+    min_q = std::min(min_q, q0);
+    min_r = std::min(min_r, r0);
+    max_q = std::max(max_q, q1);
+    max_r = std::max(max_r, r1);
+
+    int b = (int)boxes.size();
+    Box box = {item, q0, r0, q1, r1};
+    boxes.push_back(box);
+    for (int cq = cell_of(q0); cq <= cell_of(q1); cq++)
+        for (int cr = cell_of(r0); cr <= cell_of(r1); cr++)
+            cells[key(cq, cr)].push_back(b);
+}
+
+std::vector<int> HexGrid::query(int q0, int r0, int q1, int r1) const
+{
+    std::vector<int> out;
+    if (q0 > q1)
+        std::swap(q0, q1);
+    if (r0 > r1)
+        std::swap(r0, r1);
+    // Nothing lies outside the bounds, so huge rectangles cost no more
+    // than the whole map.
+    q0 = std::max(q0, min_q);
+    r0 = std::max(r0, min_r);
+    q1 = std::min(q1, max_q);
+    r1 = std::min(r1, max_r);
+    if (q0 > q1 || r0 > r1)
+        return out;
+
+    for (int cq = cell_of(q0); cq <= cell_of(q1); cq++)
+        for (int cr = cell_of(r0); cr <= cell_of(r1); cr++)
+        {
+            auto it = cells.find(key(cq, cr));
+            if (it == cells.end())
+                continue;
+            for (int b : it->second)
+            {
+                const Box &x = boxes[b];
+                if (x.q1 >= q0 && x.q0 <= q1 && x.r1 >= r0 && x.r0 <= r1)
+                    out.push_back(x.item);
+            }
+        }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
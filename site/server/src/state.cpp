@@ -33,11 +33,45 @@
 #include "app.h"
 #include "comms.h"
 #include "db.h"
+#include "flight.h"
 #include "game.h"
 #include "json.h"
+#include "snapshot.h"
 #include "typs.h"
 #include "util.h"
 
+class Presence
+{
+  public:
+    bool online = false;
+    std::string last_seen;
+};
+
+// Most recent heartbeat of 'user'. Every poll asks this of the same two
+// users, so concurrent lookups share one query. Reported to the minute so
+// that, like the game version, it only moves the ETag now and then.
+static std::shared_ptr<const Presence> peer_presence(Db *db,
+                                                     const std::string &user)
+{
+    static SingleFlight<Presence> flight;
+    return flight.run(user, [&]() {
+        std::shared_ptr<Presence> p = std::make_shared<Presence>();
+        auto prow = db->query(
+            "SELECT DATE_FORMAT(last_seen,'%Y-%m-%d %H:%i'),"
+            "(TIMESTAMPDIFF(SECOND, last_seen, NOW()) <= 90) FROM "
+            "sessions s JOIN users u ON u.id=s.user_id "
+            "WHERE u.username='" +
+            db->esc(user) + "' ORDER BY s.last_seen DESC LIMIT 1");
+        if (!prow.empty())
+        {
+            p->last_seen = prow[0][0];
+            if (!prow[0][1].empty() && prow[0][1] != "0")
+                p->online = true;
+        }
+        return std::shared_ptr<const Presence>(p);
+    });
+}
+
 void handle_state(const HttpRequest *req, Db *db, HttpResponse *resp)
 {
     char selfOwner = 0;
@@ -58,55 +92,120 @@ void handle_state(const HttpRequest *req, Db *db, HttpResponse *resp)
         return;
     }
 
-    GameState s = load_game(db, a.game_id);
+    SnapshotPtr snap = game_snapshot(db, a.game_id);
 
     selfOwner = owner_for_username(a.username);
     oppOwner = (selfOwner == 'A') ? 'B' : 'A';
     oppUser = (oppOwner == 'A') ? "alice" : "bob";
 
-    oppOnline = false;
-    oppLastSeen = "";
+    std::shared_ptr<const Presence> peer = peer_presence(db, oppUser);
+    oppOnline = peer->online;
+    oppLastSeen = peer->last_seen;
 
-    auto prow =
-        db->query("SELECT DATE_FORMAT(last_seen,'%Y-%m-%d %H:%i:%s') FROM "
-                  "sessions s JOIN users u ON u.id=s.user_id "
-                  "WHERE u.username='" +
-                  db->esc(oppUser) + "' ORDER BY s.last_seen DESC LIMIT 1");
-    if (!prow.empty())
+    // ?since=<version>: send only the members that changed since the
+    // client's copy, if that version is still in the snapshot's window.
+    const GameState *base = NULL;
+    std::string since = query_param(req->query, "since");
+    if (!since.empty() && std::isdigit((unsigned char)since[0]))
+        base = snapshot_version(*snap, std::atoi(since.c_str()));
+
+    std::ostringstream tag;
+    tag << "\"s" << a.game_id << "." << snap->state.version << "." << selfOwner
+        << "." << (oppOnline ? 1 : 0);
+    for (size_t i = 0; i < oppLastSeen.size(); i++)
+        if (std::isdigit((unsigned char)oppLastSeen[i]))
+            tag << oppLastSeen[i];
+    if (base)
+        tag << ".d" << base->version;
+    bool cbor = wants_cbor(req);
+    if (cbor)
+        tag << ".c";
+    tag << "\"";
+    resp->headers["Vary"] = "Accept";
+    std::string etag = tag.str();
+    if (not_modified(req, resp, etag))
+        return;
+
+    // Full bodies are cached per viewing side; only the two seated players
+    // (whose username follows from the side) share them.
+    CachedBodyPtr *slot = NULL;
+    if (!base && to_lower(a.username) == (selfOwner == 'A' ? "alice" : "bob"))
+        slot = &snap->state_body[selfOwner == 'A' ? 0 : 1];
+    if (slot)
     {
-        oppLastSeen = prow[0][0];
-        auto prow2 =
-            db->query("SELECT (TIMESTAMPDIFF(SECOND, last_seen, NOW()) <= 90) "
-                      "FROM sessions s JOIN users u ON u.id=s.user_id "
-                      "WHERE u.username='" +
-                      db->esc(oppUser) + "' ORDER BY s.last_seen DESC LIMIT 1");
-        if (!prow2.empty() && !prow2[0][0].empty() && prow2[0][0] != "0")
+        CachedBodyPtr cached = std::atomic_load(slot);
+        if (cached && cached->etag == etag)
         {
-            oppOnline = true;
+            resp->content_type = cached->content_type;
+            resp->body = cached->body;
+            return;
         }
     }
 
-    std::ostringstream out;
+    // Viewers polling the same thing at the same moment share one body.
+    static SingleFlight<CachedBody> flight;
+    CachedBodyPtr built = flight.run(etag + a.username, [&]() {
+        std::unique_ptr<Encoder> e = response_encoder(req);
+        e->begin_object();
+        e->key("ok");
+        e->boolean(true);
+        if (base)
+        {
+            e->key("since");
+            e->num(base->version);
+            e->key("delta");
+            snap->state.encode(*e, base);
+        }
+        else
+        {
+            e->key("state");
+            snap->state.encode(*e);
+        }
+        e->key("self");
+        e->begin_object();
+        e->key("owner");
+        e->str(std::string(1, selfOwner));
+        e->key("username");
+        e->str(a.username);
+        e->end_object();
+        e->key("peer");
+        e->begin_object();
+        e->key("owner");
+        e->str(std::string(1, oppOwner));
+        e->key("username");
+        e->str(oppUser);
+        e->key("online");
+        e->boolean(oppOnline);
+        e->key("last_seen");
+        e->str(oppLastSeen);
+        e->end_object();
+        e->end_object();
 
-    out << "{\"ok\":true,\"state\":" << s.to_json() << ",\"self\":{\"owner\":\""
-        << selfOwner << "\",\"username\":\"" << json_escape(a.username) << "\"}"
-        << ",\"peer\":{\"owner\":\"" << oppOwner << "\",\"username\":\""
-        << oppUser << "\",\"online\":" << (oppOnline ? "true" : "false")
-        << ",\"last_seen\":\"" << json_escape(oppLastSeen) << "\"}"
-        << "}";
+        std::shared_ptr<CachedBody> c = std::make_shared<CachedBody>();
+        c->etag = etag;
+        c->content_type = e->content_type();
+        c->body.swap(e->out);
+        return CachedBodyPtr(c);
+    });
 
-    resp->body = out.str();
+    resp->content_type = built->content_type;
+    resp->body = built->body;
+    if (slot)
+        std::atomic_store(slot, built);
     return;
 }
 
-std::string json_ok_with_state_and_event(const GameState &s,
-                                         const std::string &eventText)
+void reply_state_and_event(const HttpRequest *req, HttpResponse *resp,
+                           const GameState &s, const std::string &eventText)
 {
-    std::ostringstream o;
-    o << "{";
-    o << "\"ok\":true,";
-    o << "\"event\":\"" << json_escape(eventText) << "\",";
-    o << "\"state\":" << s.to_json();
-    o << "}";
-    return o.str();
+    std::unique_ptr<Encoder> e = response_encoder(req);
+    e->begin_object();
+    e->key("ok");
+    e->boolean(true);
+    e->key("event");
+    e->str(eventText);
+    e->key("state");
+    s.encode(*e);
+    e->end_object();
+    set_body(resp, *e);
 }
@@ -0,0 +1,204 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "static_files.h"
+
+#include "app.h"
+#include "comms.h"
+#include "util.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+void StaticFiles::open(const std::string &dir, const std::string &prefix)
+{
+    struct stat st;
+    if (::stat(dir.c_str(), &st) != 0 || !S_ISDIR(st.st_mode))
+        throw std::runtime_error("static: not a directory: " + dir);
+    root = dir;
+    if (!root.empty() && root[root.size() - 1] == '/')
+        root.resize(root.size() - 1);
+    mount = prefix.empty() ? "/" : prefix;
+    if (mount[0] != '/')
+        mount = "/" + mount;
+    if (mount[mount.size() - 1] != '/')
+        mount += "/";
+}
+
+void StaticFiles::map_api(HttpRequest &req) const
+{
+    if (enabled() && mount != "/" && starts_with(req.path, mount + "api/"))
+        req.path = req.path.substr(mount.size() - 1);
+}
+
+static std::string content_type_for(const std::string &path)
+{
+    static const char *types[][2] = {
+        {".html", "text/html; charset=utf-8"},
+        {".js", "application/javascript; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".json", "application/json"},
+        {".svg", "image/svg+xml"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".ico", "image/x-icon"},
+        {".csv", "text/csv; charset=utf-8"},
+        {".txt", "text/plain; charset=utf-8"},
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+    {
+        std::string ext = types[i][0];
+        if (path.size() > ext.size() &&
+            path.compare(path.size() - ext.size(), ext.size(), ext) == 0)
+            return types[i][1];
+    }
+    return "application/octet-stream";
+}
+
+static std::string http_date(time_t t)
+{
+    struct tm g;
+    gmtime_r(&t, &g);
+    char buf[64];
+    std::strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &g);
+    return buf;
+}
+
+// True if 'coding' is listed in Accept-Encoding without q=0.
+static bool accepts(const HttpRequest *req, const std::string &coding)
+{
+    auto it = req->headers.find("accept-encoding");
+    if (it == req->headers.end())
+        return false;
+    std::istringstream is(to_lower(it->second));
+    std::string t;
+    while (std::getline(is, t, ','))
+    {
+        size_t semi = t.find(';');
+        std::string name = trim(t.substr(0, semi));
+        if (name != coding)
+            continue;
+        if (semi == std::string::npos)
+            return true;
+        std::string q = trim(t.substr(semi + 1));
+        return !(starts_with(q, "q=0") && q.find_first_of("123456789") ==
+                                               std::string::npos);
+    }
+    return false;
+}
+
+bool StaticFiles::serve(const HttpRequest *req, HttpResponse *resp) const
+{
+    if (!enabled() || req->method != "GET")
+        return false;
+    if (!starts_with(req->path, mount) && req->path + "/" != mount)
+        return false;
+
+    std::string rel = (req->path.size() > mount.size())
+                          ? req->path.substr(mount.size())
+                          : std::string();
+    if (rel.empty() || rel[rel.size() - 1] == '/')
+        rel += "index.html";
+    if (rel.find("..") != std::string::npos || rel.find('\\') != std::string::npos ||
+        rel.find('%') != std::string::npos || rel[0] == '/')
+        return false;
+
+    std::string path = root + "/" + rel;
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    // Prefer a precompressed sibling the client can take.
+    std::string send_path = path;
+    std::string encoding, suffix;
+    static const char *variants[][2] = {{"br", ".br"}, {"gzip", ".gz"}};
+    for (size_t i = 0; i < 2 && encoding.empty(); i++)
+    {
+        struct stat vs;
+        std::string vp = path + variants[i][1];
+        if (accepts(req, variants[i][0]) && ::stat(vp.c_str(), &vs) == 0 &&
+            S_ISREG(vs.st_mode))
+        {
+            send_path = vp;
+            encoding = variants[i][0];
+            suffix = variants[i][1] + 1;
+            st = vs;
+        }
+    }
+
+    std::ostringstream tag;
+    tag << "\"" << std::hex << (unsigned long long)st.st_size << "-"
+        << (unsigned long long)st.st_mtim.tv_sec << "."
+        << (unsigned long long)st.st_mtim.tv_nsec;
+    if (!encoding.empty())
+        tag << "-" << suffix;
+    tag << "\"";
+
+    resp->content_type = content_type_for(path);
+    resp->headers["Last-Modified"] = http_date(st.st_mtime);
+    resp->headers["Vary"] = "Accept-Encoding";
+    if (!encoding.empty())
+        resp->headers["Content-Encoding"] = encoding;
+    resp->headers["Cache-Control"] =
+        query_param(req->query, "v").empty()
+            ? "no-cache"
+            : "public, max-age=31536000, immutable";
+
+    if (not_modified(req, resp, tag.str()))
+        return true;
+    auto ims = req->headers.find("if-modified-since");
+    if (ims != req->headers.end() &&
+        req->headers.find("if-none-match") == req->headers.end())
+    {
+        struct tm t;
+        std::memset(&t, 0, sizeof(t));
+        if (strptime(ims->second.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &t) &&
+            timegm(&t) >= st.st_mtime)
+        {
+            resp->status = 304;
+            return true;
+        }
+    }
+
+    int fd = ::open(send_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    resp->file_fd = fd;
+    resp->file_size = (long long)st.st_size;
+    return true;
+}
+
+StaticFiles &static_files()
+{
+    static StaticFiles s;
+    return s;
+}
@@ -0,0 +1,484 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "tablebase.h"
+
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+
+#include "app.h"
+
+// Entries are uint16: the top two bits hold KH_TB_*, the low 14 bits the
+// distance. Sections for every material class (a, b) with a <= max_a and
+// b <= max_b follow the header in order; each holds 2 * n^(a+b) entries
+// indexed by side to move, then A's regions, then B's regions (base n,
+// most significant first). Only tuples sorted within a side are used.
+
+#define TB_UNKNOWN 0xFFFF
+
+static uint16_t tb_pack(int wdl, int distance)
+{
+    return (uint16_t)((wdl << 14) | (std::min(distance, 0x3FFF)));
+}
+
+static uint64_t ipow(uint64_t b, int e)
+{
+    uint64_t r = 1;
+    while (e-- > 0)
+        r *= b;
+    return r;
+}
+
+static uint64_t section_offset(int n, int max_a, int max_b, int a, int b)
+{
+    uint64_t off = 0;
+    for (int i = 0; i <= max_a; i++)
+    {
+        for (int j = 0; j <= max_b; j++)
+        {
+            if (i == a && j == b)
+                return off;
+            off += 2 * ipow(n, i + j);
+        }
+    }
+    return off;
+}
+
+static bool tb_encode(int n, int max_a, int max_b, const Position &p,
+                      uint64_t &idx)
+{
+    int regs[2][KH_TB_MAX_SHIPS];
+    int cnt[2] = {0, 0};
+    for (int i = 0; i < p.nships; i++)
+    {
+        const PackedShip &s = p.ships[i];
+        if (s.carrier != KH_NO_SHIP)
+            continue;
+        if (s.type != 'W')
+        {
+            if (s.region != KH_NO_REGION)
+                return false;
+            continue;
+        }
+        if (s.region == KH_NO_REGION || cnt[s.owner] >= KH_TB_MAX_SHIPS)
+            return false;
+        regs[s.owner][cnt[s.owner]++] = s.region;
+    }
+    if (cnt[0] > max_a || cnt[1] > max_b)
+        return false;
+
+    uint64_t v = p.to_move;
+    for (int side = 0; side < 2; side++)
+    {
+        std::sort(regs[side], regs[side] + cnt[side]);
+        for (int k = 0; k < cnt[side]; k++)
+            v = v * n + regs[side][k];
+    }
+    idx = section_offset(n, max_a, max_b, cnt[0], cnt[1]) + v;
+    return true;
+}
+
+// Rebuilds the position stored at 'idx'. Returns false for unused slots:
+// unsorted tuples and placements where both sides share a region.
+static bool tb_decode(int n, int max_a, int max_b, uint64_t idx,
+                      Position &p)
+{
+    int a = 0, b = 0;
+    uint64_t off = 0;
+    bool found = false;
+    for (int i = 0; i <= max_a && !found; i++)
+    {
+        for (int j = 0; j <= max_b; j++)
+        {
+            uint64_t sz = 2 * ipow(n, i + j);
+            if (idx < off + sz)
+            {
+                a = i;
+                b = j;
+                found = true;
+                break;
+            }
+            off += sz;
+        }
+    }
+    if (!found)
+        return false;
+
+    uint64_t v = idx - off;
+    int digits[2 * KH_TB_MAX_SHIPS];
+    for (int k = a + b - 1; k >= 0; k--)
+    {
+        digits[k] = (int)(v % n);
+        v /= n;
+    }
+
+    p = Position();
+    p.to_move = (uint8_t)v;
+    for (int k = 0; k < a + b; k++)
+    {
+        int side = (k < a) ? 0 : 1;
+        bool first = (k == 0 || k == a);
+        if (!first && digits[k] < digits[k - 1])
+            return false;
+        if (side == 1 && p.occ[0].test(digits[k]))
+            return false;
+        PackedShip s;
+        std::memset(&s, 0, sizeof(s));
+        s.owner = (uint8_t)side;
+        s.type = 'W';
+        s.num = (uint8_t)(side ? k - a + 1 : k + 1);
+        s.carrier = KH_NO_SHIP;
+        s.region = (uint16_t)digits[k];
+        p.add_ship(s);
+    }
+    return true;
+}
+
+static bool side_has_won(const GameMap &m, const Position &p)
+{
+    int me = p.to_move;
+    for (auto b : m.bases[1 - me])
+    {
+        if (p.occ[me].test(b))
+            return true;
+    }
+    return false;
+}
+
+template <typename Visit>
+static void for_each_child(const GameMap &m, int n, int max_a, int max_b,
+                           const Position &p, std::vector<Move> &moves,
+                           Visit visit)
+{
+    generate_moves(m, p, moves);
+    for (auto &mv : moves)
+    {
+        Position child = p;
+        make_move(m, child, mv);
+        uint64_t c = 0;
+        if (!tb_encode(n, max_a, max_b, child, c))
+            throw std::runtime_error("tablebase: child outside table");
+        visit(c);
+    }
+}
+
+template <typename Fn>
+static void parallel_for(int threads, uint64_t total, Fn fn)
+{
+    std::vector<std::thread> pool;
+    uint64_t chunk = (total + threads - 1) / threads;
+    for (int t = 0; t < threads; t++)
+    {
+        uint64_t lo = std::min(total, chunk * t);
+        uint64_t hi = std::min(total, lo + chunk);
+        pool.push_back(std::thread(fn, t, lo, hi));
+    }
+    for (auto &th : pool)
+        th.join();
+}
+
+void build_tablebase(const GameMap &m, int max_a, int max_b, int threads,
+                     const std::string &path)
+{
+    int n = m.size();
+    if (n == 0 || n > KH_MAX_REGIONS)
+        throw std::runtime_error("tablebase: unsupported map size");
+    if (max_a < 0 || max_b < 0 || max_a > KH_TB_MAX_SHIPS ||
+        max_b > KH_TB_MAX_SHIPS)
+        throw std::runtime_error("tablebase: unsupported material");
+    if (threads < 1)
+        threads = 1;
+
+    uint64_t total = section_offset(n, max_a, max_b, max_a + 1, 0);
+    if (total >= 0xFFFFFFFFULL)
+        throw std::runtime_error("tablebase: too many positions");
+
+    std::vector<std::atomic<uint16_t>> value(total);
+    std::vector<std::atomic<uint32_t>> pending(total);
+    std::vector<std::atomic<uint32_t>> indeg(total);
+    for (uint64_t i = 0; i < total; i++)
+        indeg[i].store(0);
+
+    // Pass 1: classify every slot, count moves and predecessors.
+    std::vector<std::vector<uint32_t>> seeds(threads);
+    parallel_for(threads, total, [&](int t, uint64_t lo, uint64_t hi) {
+        std::vector<Move> moves;
+        Position p;
+        for (uint64_t i = lo; i < hi; i++)
+        {
+            if (!tb_decode(n, max_a, max_b, i, p))
+            {
+                value[i].store(tb_pack(KH_TB_UNUSED, 0));
+                continue;
+            }
+            if (side_has_won(m, p))
+            {
+                value[i].store(tb_pack(KH_TB_WIN, 0));
+                seeds[t].push_back((uint32_t)i);
+                continue;
+            }
+            value[i].store(TB_UNKNOWN);
+            uint32_t cnt = 0;
+            for_each_child(m, n, max_a, max_b, p, moves, [&](uint64_t c) {
+                indeg[c].fetch_add(1);
+                cnt++;
+            });
+            pending[i].store(cnt);
+        }
+    });
+
+    // Reverse edges (CSR): predecessors of every position.
+    std::vector<uint64_t> rev_off(total + 1);
+    rev_off[0] = 0;
+    for (uint64_t i = 0; i < total; i++)
+    {
+        rev_off[i + 1] = rev_off[i] + indeg[i].load();
+        indeg[i].store(0);
+    }
+    std::vector<uint32_t> rev(rev_off[total]);
+
+    parallel_for(threads, total, [&](int, uint64_t lo, uint64_t hi) {
+        std::vector<Move> moves;
+        Position p;
+        for (uint64_t i = lo; i < hi; i++)
+        {
+            if (value[i].load() != TB_UNKNOWN)
+                continue;
+            tb_decode(n, max_a, max_b, i, p);
+            for_each_child(m, n, max_a, max_b, p, moves, [&](uint64_t c) {
+                rev[rev_off[c] + indeg[c].fetch_add(1)] = (uint32_t)i;
+            });
+        }
+    });
+
+    // Retrograde propagation, one distance level at a time. A predecessor
+    // of a lost position is won; a predecessor whose moves all reach won
+    // positions is lost.
+    std::vector<uint32_t> frontier;
+    for (auto &v : seeds)
+        frontier.insert(frontier.end(), v.begin(), v.end());
+
+    for (int d = 0; !frontier.empty(); d++)
+    {
+        std::vector<std::vector<uint32_t>> next(threads);
+        parallel_for(threads, frontier.size(),
+                     [&](int t, uint64_t lo, uint64_t hi) {
+                         for (uint64_t k = lo; k < hi; k++)
+                         {
+                             uint32_t c = frontier[k];
+                             int wdl = value[c].load() >> 14;
+                             for (uint64_t e = rev_off[c]; e < rev_off[c + 1];
+                                  e++)
+                             {
+                                 uint32_t pi = rev[e];
+                                 uint16_t expect = TB_UNKNOWN;
+                                 if (wdl == KH_TB_LOSS)
+                                 {
+                                     if (value[pi].compare_exchange_strong(
+                                             expect, tb_pack(KH_TB_WIN, d + 1)))
+                                         next[t].push_back(pi);
+                                 }
+                                 else if (pending[pi].fetch_sub(1) == 1)
+                                 {
+                                     if (value[pi].compare_exchange_strong(
+                                             expect,
+                                             tb_pack(KH_TB_LOSS, d + 1)))
+                                         next[t].push_back(pi);
+                                 }
+                             }
+                         }
+                     });
+        frontier.clear();
+        for (auto &v : next)
+            frontier.insert(frontier.end(), v.begin(), v.end());
+    }
+
+    std::vector<uint16_t> out(total);
+    for (uint64_t i = 0; i < total; i++)
+    {
+        uint16_t v = value[i].load();
+        out[i] = (v == TB_UNKNOWN) ? tb_pack(KH_TB_DRAW, 0) : v;
+    }
+
+    TablebaseHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, KH_TB_MAGIC, sizeof(h.magic));
+    h.map_hash = map_fingerprint(m);
+    h.regions = (uint32_t)n;
+    h.max_a = (uint32_t)max_a;
+    h.max_b = (uint32_t)max_b;
+    h.entries = total;
+
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (!f)
+        throw std::runtime_error("tablebase: cannot write " + path);
+    bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+              std::fwrite(out.data(), sizeof(uint16_t), total, f) == total;
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok)
+        throw std::runtime_error("tablebase: short write to " + path);
+}
+
+Tablebase::Tablebase() : base(NULL), len(0), hdr(NULL), entries(NULL)
+{
+}
+
+Tablebase::~Tablebase()
+{
+    if (base)
+        munmap(base, len);
+}
+
+void Tablebase::open(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("tablebase: cannot open " + path);
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(TablebaseHeader))
+    {
+        ::close(fd);
+        throw std::runtime_error("tablebase: truncated " + path);
+    }
+    void *p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw std::runtime_error("tablebase: mmap failed for " + path);
+
+    const TablebaseHeader *h = (const TablebaseHeader *)p;
+    if (std::memcmp(h->magic, KH_TB_MAGIC, sizeof(h->magic)) != 0 ||
+        h->max_a > KH_TB_MAX_SHIPS || h->max_b > KH_TB_MAX_SHIPS ||
+        sizeof(TablebaseHeader) + h->entries * sizeof(uint16_t) !=
+            (uint64_t)st.st_size)
+    {
+        munmap(p, st.st_size);
+        throw std::runtime_error("tablebase: bad header in " + path);
+    }
+
+    if (base)
+        munmap(base, len);
+    base = p;
+    len = st.st_size;
+    hdr = h;
+    entries = (const uint16_t *)(h + 1);
+}
+
+bool Tablebase::matches(const GameMap &m) const
+{
+    return hdr && (int)hdr->regions == m.size() &&
+           hdr->map_hash == map_fingerprint(m);
+}
+
+bool Tablebase::probe(const GameMap &m, const Position &p,
+                      TbResult &out) const
+{
+    if (!matches(m) || p.winner)
+        return false;
+    // only sudden-death positions are tabulated
+    if (p.vp[0] + 1 < p.vp_need || p.vp[1] + 1 < p.vp_need)
+        return false;
+
+    uint64_t idx = 0;
+    if (!tb_encode(hdr->regions, hdr->max_a, hdr->max_b, p, idx) ||
+        idx >= hdr->entries)
+        return false;
+    uint16_t e = entries[idx];
+    if ((e >> 14) == KH_TB_UNUSED)
+        return false;
+    out.wdl = e >> 14;
+    out.distance = e & 0x3FFF;
+    return true;
+}
+
+// Picks the move with the best tabulated outcome: the fastest win, else a
+// draw, else the slowest loss.
+bool Tablebase::best_move(const GameMap &m, const Position &p, Move &mv,
+                          TbResult &out) const
+{
+    TbResult here;
+    if (!probe(m, p, here))
+        return false;
+    // already decided at the start of this turn; nothing to play
+    if (here.wdl != KH_TB_DRAW && here.distance == 0)
+        return false;
+
+    std::vector<Move> moves;
+    generate_moves(m, p, moves);
+
+    auto rank = [](const TbResult &r) -> int {
+        if (r.wdl == KH_TB_WIN)
+            return 100000 - r.distance;
+        if (r.wdl == KH_TB_DRAW)
+            return 0;
+        return -100000 + r.distance;
+    };
+
+    bool found = false;
+    for (auto &cand : moves)
+    {
+        Position child = p;
+        make_move(m, child, cand);
+
+        TbResult r;
+        if (child.winner)
+        {
+            r.wdl = KH_TB_LOSS;
+            r.distance = 1;
+        }
+        else
+        {
+            TbResult cr;
+            if (!probe(m, child, cr))
+                continue;
+            r.distance = cr.wdl == KH_TB_DRAW ? 0 : cr.distance + 1;
+            r.wdl = cr.wdl == KH_TB_WIN
+                        ? KH_TB_LOSS
+                        : (cr.wdl == KH_TB_LOSS ? KH_TB_WIN : KH_TB_DRAW);
+        }
+        if (!found || rank(r) > rank(out))
+        {
+            mv = cand;
+            out = r;
+            found = true;
+        }
+    }
+    return found;
+}
+
+Tablebase &endgame_tablebase()
+{
+    static Tablebase tb;
+    return tb;
+}
@@ -0,0 +1,363 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+#include "tiles.h"
+
+#include "app.h"
+#include "comms.h"
+#include "flight.h"
+#include "mapview.h"
+#include "snapshot.h"
+#include "util.h"
+
+#include <cmath>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// Ships a side sees, counted per region, as of one game version.
+class FleetCounts
+{
+  public:
+    int version = -1;
+    std::vector<std::pair<int, int>> count; // region -> (A, B)
+};
+
+typedef std::shared_ptr<const FleetCounts> FleetCountsPtr;
+
+static FleetCountsPtr fleet_counts(Db *db, const MapDoc &d,
+                                   const GameSnapshot &snap, char side)
+{
+    int game_id = snap.state.game_id, version = snap.state.version;
+    static std::mutex mu;
+    static std::map<std::string, FleetCountsPtr> latest; // game.side
+    static SingleFlight<FleetCounts> flight;
+
+    std::string key = std::to_string(game_id) + "." + side;
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = latest.find(key);
+        if (it != latest.end() && it->second->version == version)
+            return it->second;
+    }
+    FleetCountsPtr f =
+        flight.run(key + "." + std::to_string(version), [&]() {
+            std::shared_ptr<FleetCounts> c = std::make_shared<FleetCounts>();
+            c->version = version;
+            c->count.assign(d.map->size(), std::make_pair(0, 0));
+            for (auto &v : visible_ships(db, *d.map, snap, side))
+                (v.owner == 'A' ? c->count[v.region].first
+                                : c->count[v.region].second)++;
+            return FleetCountsPtr(c);
+        });
+    std::lock_guard<std::mutex> g(mu);
+    FleetCountsPtr &slot = latest[key];
+    if (!slot || slot->version < f->version)
+        slot = f;
+    return f;
+}
+
+class TileCache
+{
+  public:
+    // The body cached under 'key' if it was drawn from 'content'.
+    CachedBodyPtr get(const std::string &key, uint64_t content)
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = entries.find(key);
+        if (it == entries.end() || it->second.content != content)
+            return CachedBodyPtr();
+        order.splice(order.begin(), order, it->second.lru);
+        return it->second.body;
+    }
+
+    void put(const std::string &key, uint64_t content, CachedBodyPtr body)
+    {
+        std::lock_guard<std::mutex> g(mu);
+        auto it = entries.find(key);
+        if (it != entries.end())
+        {
+            it->second.content = content;
+            it->second.body = body;
+            order.splice(order.begin(), order, it->second.lru);
+            return;
+        }
+        order.push_front(key);
+        Entry e = {content, body, order.begin()};
+        entries[key] = e;
+        while (entries.size() > KH_TILE_CACHE)
+        {
+            entries.erase(order.back());
+            order.pop_back();
+        }
+    }
+
+  private:
+    struct Entry
+    {
+        uint64_t content;
+        CachedBodyPtr body;
+        std::list<std::string>::iterator lru;
+    };
+    std::mutex mu;
+    std::list<std::string> order; // most recently used first
+    std::unordered_map<std::string, Entry> entries;
+};
+
+static uint64_t fnv(uint64_t h, const std::string &v)
+{
+    for (size_t i = 0; i < v.size(); i++)
+    {
+        h ^= (unsigned char)v[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void point(std::ostringstream &o, double x, double y)
+{
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%.1f,%.1f ", x, y);
+    o << buf;
+}
+
+static std::string xml_escape(const std::string &s)
+{
+    std::string out;
+    for (char c : s)
+    {
+        if (c == '<')
+            out += "&lt;";
+        else if (c == '>')
+            out += "&gt;";
+        else if (c == '&')
+            out += "&amp;";
+        else if (c == '"')
+            out += "&quot;";
+        else
+            out += c;
+    }
+    return out;
+}
+
+// Hex outlines and names on close enough tiles; warplines, stars, bases and
+// fleets always.
+static std::string render_tile(const MapDoc &d, const FleetCounts &f,
+                               int x0, int y0, int span,
+                               const std::vector<int> &hexes,
+                               const std::vector<int> &systems,
+                               const std::vector<int> &warplines)
+{
+    const GameMap &m = *d.map;
+    std::ostringstream o;
+    o << "<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"" << KH_TILE_PIXELS
+      << "\" height=\"" << KH_TILE_PIXELS << "\" viewBox=\"" << x0 << " "
+      << y0 << " " << span << " " << span << "\">"
+      << "<style>"
+         ".hex{fill:none;stroke:black;stroke-width:1}"
+         ".warpline{stroke:indigo;stroke-width:2}"
+         ".star-icon{fill:#111}"
+         ".base-ring{fill:none;stroke:indigo;stroke-width:2;opacity:.7}"
+         "text{font-family:ui-sans-serif,system-ui,Arial;text-anchor:middle}"
+         ".star-name{font-size:14pt;fill:indigo;font-weight:700}"
+         ".fleet{font-size:10pt;font-weight:700}"
+         ".fleet-A{fill:#1f4fbf}.fleet-B{fill:#bf2f1f}"
+         "</style>";
+
+    if (span <= 1024)
+        for (int i : hexes)
+        {
+            double cx = d.hex_x[i], cy = d.hex_y[i];
+            o << "<polygon class=\"hex\" points=\"";
+            point(o, cx - 20, cy - KH_HEX_HALF_H);
+            point(o, cx + 20, cy - KH_HEX_HALF_H);
+            point(o, cx + 40, cy);
+            point(o, cx + 20, cy + KH_HEX_HALF_H);
+            point(o, cx - 20, cy + KH_HEX_HALF_H);
+            point(o, cx - 40, cy);
+            o << "\"/>";
+        }
+
+    // Only placed systems and warplines with both ends on the board are in
+    // the board indexes, so their hexes are known.
+    for (int i : warplines)
+    {
+        int a = d.warp_a[i], b = d.warp_b[i];
+        char buf[160];
+        std::snprintf(buf, sizeof(buf),
+                      "<line class=\"warpline\" x1=\"%.1f\" y1=\"%.1f\" "
+                      "x2=\"%.1f\" y2=\"%.1f\"/>",
+                      d.hex_x[a], d.hex_y[a], d.hex_x[b], d.hex_y[b]);
+        o << buf;
+    }
+
+    for (int r : systems)
+    {
+        int h = d.sys_hex[r];
+        double cx = d.hex_x[h], cy = d.hex_y[h];
+        bool base = m.base_owner[r] != 0;
+        double R = base ? 12 : 8, ri = base ? 5 : 3.5;
+        o << "<polygon class=\"star-icon\" points=\"";
+        for (int k = 0; k < 16; k++)
+        {
+            double ang = -M_PI / 2 + k * (M_PI / 8);
+            double rad = (k % 2 == 0) ? R : ri;
+            point(o, cx + rad * std::cos(ang), cy + rad * std::sin(ang));
+        }
+        o << "\"/>";
+        char buf[160];
+        if (base)
+        {
+            std::snprintf(buf, sizeof(buf),
+                          "<circle class=\"base-ring\" cx=\"%.1f\" "
+                          "cy=\"%.1f\" r=\"18\"/>",
+                          cx, cy);
+            o << buf;
+        }
+        if (span <= 2048)
+        {
+            std::snprintf(buf, sizeof(buf),
+                          "<text class=\"star-name\" x=\"%.1f\" y=\"%.1f\">",
+                          cx, cy - 18);
+            o << buf << xml_escape(m.names[r]) << "</text>";
+        }
+        const std::pair<int, int> &c = f.count[r];
+        if (c.first || c.second)
+        {
+            std::snprintf(buf, sizeof(buf),
+                          "<text class=\"fleet\" x=\"%.1f\" y=\"%.1f\">", cx,
+                          cy + 30);
+            o << buf;
+            if (c.first)
+                o << "<tspan class=\"fleet-A\">A" << c.first << "</tspan>";
+            if (c.first && c.second)
+                o << " ";
+            if (c.second)
+                o << "<tspan class=\"fleet-B\">B" << c.second << "</tspan>";
+            o << "</text>";
+        }
+    }
+    o << "</svg>";
+    return o.str();
+}
+
+static bool int_param(const std::string &query, const char *key, int *v)
+{
+    std::string s = query_param(query, key);
+    if (s.empty())
+        return false;
+    char *end = NULL;
+    long n = std::strtol(s.c_str(), &end, 10);
+    if (*end || n < 0 || n > 1000000L)
+        return false;
+    *v = (int)n;
+    return true;
+}
+
+void handle_tile(const HttpRequest *req, Db *db, HttpResponse *resp)
+{
+    if (req->method != "GET")
+    {
+        resp->status = 405;
+        resp->body = json_error("method");
+        return;
+    }
+    AuthContext a = require_auth(db, req, resp);
+    if (resp->status != 200)
+        return;
+
+    MapDocPtr d = map_doc(db, a.game_id);
+    if (d->empty)
+    {
+        resp->status = 404;
+        resp->body = json_error("no map for game");
+        return;
+    }
+
+    int z, x, y;
+    if (!int_param(req->query, "z", &z) || !int_param(req->query, "x", &x) ||
+        !int_param(req->query, "y", &y) || z > 30 ||
+        (d->tile_span >> z) < KH_TILE_MIN_SPAN || x >= (1 << z) ||
+        y >= (1 << z))
+    {
+        resp->status = 400;
+        resp->body = json_error("bad tile");
+        return;
+    }
+
+    SnapshotPtr snap = game_snapshot(db, a.game_id);
+    char side = owner_for_username(a.username);
+    FleetCountsPtr f =
+        fleet_counts(db, *d, *snap, side);
+
+    int span = d->tile_span >> z;
+    int x0 = d->tile_x0 + x * span, y0 = d->tile_y0 + y * span;
+    std::vector<int> hexes =
+        d->board_hexes.query(x0, y0, x0 + span - 1, y0 + span - 1);
+    std::vector<int> systems =
+        d->board_systems.query(x0, y0, x0 + span - 1, y0 + span - 1);
+    std::vector<int> warplines =
+        d->board_warplines.query(x0, y0, x0 + span - 1, y0 + span - 1);
+
+    // What the tile shows: the map itself and the fleets at its systems.
+    std::ostringstream what;
+    what << d->etag << "." << z << "." << x << "." << y;
+    for (int r : systems)
+        what << "." << r << ":" << f->count[r].first << ","
+             << f->count[r].second;
+    uint64_t content = fnv(1469598103934665603ULL, what.str());
+
+    char tag[64];
+    std::snprintf(tag, sizeof(tag), "\"t%016llx\"", (unsigned long long)content);
+    resp->content_type = "image/svg+xml";
+    if (not_modified(req, resp, tag))
+        return;
+
+    static TileCache cache;
+    static SingleFlight<CachedBody> flight;
+    std::ostringstream key;
+    key << a.game_id << "." << side << "." << z << "." << x << "." << y;
+    CachedBodyPtr body = cache.get(key.str(), content);
+    if (!body)
+    {
+        body = flight.run(tag, [&]() {
+            std::shared_ptr<CachedBody> c = std::make_shared<CachedBody>();
+            c->etag = tag;
+            c->content_type = "image/svg+xml";
+            c->body = render_tile(*d, *f, x0, y0, span, hexes, systems,
+                                  warplines);
+            return CachedBodyPtr(c);
+        });
+        cache.put(key.str(), content, body);
+    }
+    resp->body = body->body;
+}
@@ -96,3 +96,41 @@ std::vector<std::string> split_ws(const std::string &s)
         out.push_back(tok);
     return out;
 }
+
+// Value of 'key' in an application/x-www-form-urlencoded query string
+// ("a=1&b=2"); "" when absent. Only '+' and %XX escapes are decoded.
+std::string query_param(const std::string &query, const std::string &key)
+{
+    size_t p = 0;
+    while (p <= query.size())
+    {
+        size_t e = query.find('&', p);
+        if (e == std::string::npos)
+            e = query.size();
+        std::string kv = query.substr(p, e - p);
+        size_t eq = kv.find('=');
+        if (kv.substr(0, eq) == key)
+        {
+            std::string v = (eq == std::string::npos) ? "" : kv.substr(eq + 1);
+            std::string out;
+            for (size_t i = 0; i < v.size(); i++)
+            {
+                if (v[i] == '+')
+                    out.push_back(' ');
+                else if (v[i] == '%' && i + 2 < v.size() &&
+                         std::isxdigit((unsigned char)v[i + 1]) &&
+                         std::isxdigit((unsigned char)v[i + 2]))
+                {
+                    out.push_back((char)std::strtol(v.substr(i + 1, 2).c_str(),
+                                                    NULL, 16));
+                    i += 2;
+                }
+                else
+                    out.push_back(v[i]);
+            }
+            return out;
+        }
+        p = e + 1;
+    }
+    return "";
+}
@@ -0,0 +1,122 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+// kh-perft: node-count benchmark for the search position and move generator.
+//
+//   kh-perft [--csv DIR] [--map ID] [--depth N] [--ships K]
+//            [--scenario learning|basic|advanced]
+//
+// Loads the map from the seed CSVs, places K warpships per side on that
+// side's base systems and reports perft(1..N) with moves per second.
+
+#include <chrono>
+#include <cstdio>
+
+#include "app.h"
+#include "game.h"
+#include "map.h"
+#include "position.h"
+
+int main(int argc, char **argv)
+{
+    std::string csv = "../db";
+    std::string scenario = "learning";
+    int map_id = 1;
+    int depth = 5;
+    int ships = 2;
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string k = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("missing arg for " + k);
+                return argv[++i];
+            };
+            if (k == "--csv")
+                csv = next();
+            else if (k == "--map")
+                map_id = std::atoi(next().c_str());
+            else if (k == "--depth")
+                depth = std::atoi(next().c_str());
+            else if (k == "--ships")
+                ships = std::atoi(next().c_str());
+            else if (k == "--scenario")
+                scenario = next();
+            else
+                throw std::runtime_error("unknown arg " + k);
+        }
+
+        GameMap m = load_map_csv(csv, map_id);
+        if (m.bases[0].empty() || m.bases[1].empty())
+            throw std::runtime_error("map has no owned bases for both sides");
+
+        Position p;
+        p.vp_need = (uint8_t)vp_needed(scenario);
+        for (int side = 0; side < 2; side++)
+        {
+            for (int k = 0; k < ships; k++)
+            {
+                PackedShip s;
+                std::memset(&s, 0, sizeof(s));
+                s.owner = (uint8_t)side;
+                s.type = 'W';
+                s.num = (uint8_t)(k + 1);
+                s.carrier = KH_NO_SHIP;
+                s.region = (uint16_t)
+                    m.bases[side][k % m.bases[side].size()];
+                p.add_ship(s);
+            }
+        }
+
+        std::printf("map: %d regions, %d links; %d warpships per side\n",
+                    m.size(), (int)m.adj.size() / 2, ships);
+        for (int d = 1; d <= depth; d++)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            uint64_t n = perft(m, p, d);
+            auto t1 = std::chrono::steady_clock::now();
+            double secs = std::chrono::duration<double>(t1 - t0).count();
+            std::printf("perft(%d) = %llu  %.3fs  %.0f moves/s\n", d,
+                        (unsigned long long)n, secs,
+                        secs > 0 ? (double)n / secs : 0.0);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "kh-perft: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+// kh-tbgen: builds an endgame tablebase for one map by retrograde analysis.
+//
+//   kh-tbgen [--csv DIR] [--map ID] [--ships-a N] [--ships-b N]
+//            [--threads N] --out FILE
+//
+// The resulting file is mmap'd by 'kh --tablebase FILE'.
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "app.h"
+#include "map.h"
+#include "tablebase.h"
+
+int main(int argc, char **argv)
+{
+    std::string csv = "../db";
+    std::string out;
+    int map_id = 1;
+    int max_a = KH_TB_MAX_SHIPS;
+    int max_b = KH_TB_MAX_SHIPS;
+    int threads = (int)std::thread::hardware_concurrency();
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string k = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("missing arg for " + k);
+                return argv[++i];
+            };
+            if (k == "--csv")
+                csv = next();
+            else if (k == "--map")
+                map_id = std::atoi(next().c_str());
+            else if (k == "--ships-a")
+                max_a = std::atoi(next().c_str());
+            else if (k == "--ships-b")
+                max_b = std::atoi(next().c_str());
+            else if (k == "--threads")
+                threads = std::atoi(next().c_str());
+            else if (k == "--out")
+                out = next();
+            else
+                throw std::runtime_error("unknown arg " + k);
+        }
+        if (out.empty())
+            throw std::runtime_error("--out is required");
+
+        GameMap m = load_map_csv(csv, map_id);
+        std::printf("map: %d regions; material up to %dv%d; %d threads\n",
+                    m.size(), max_a, max_b, std::max(1, threads));
+
+        auto t0 = std::chrono::steady_clock::now();
+        build_tablebase(m, max_a, max_b, threads, out);
+        auto t1 = std::chrono::steady_clock::now();
+
+        Tablebase tb;
+        tb.open(out);
+        std::printf("wrote %s in %.2fs\n", out.c_str(),
+                    std::chrono::duration<double>(t1 - t0).count());
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "kh-tbgen: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,778 @@
+///////////////////////////////////////////////////////////////////////////////////
+// BSD 3-Clause License
+// 
+// This file is part of Kepler's Horizon
+//
+// Copyright (c) 2025, sibomots
+// 
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this
+//    list of conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice,
+//    this list of conditions and the following disclaimer in the documentation
+//    and/or other materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its
+//    contributors may be used to endorse or promote products derived from
+//    this software without specific prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+// DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+// FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+// DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+// SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+// CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+// OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+/////////////////////////////////////////////////////////////////////////////////
+// kh-worldgen: generates a synthetic galaxy and games played on it, for
+// exercising the server at sizes the seed map never reaches.
+//
+//   kh-worldgen --out DIR [--map ID] [--hexes N] [--systems N] [--degree D]
+//               [--bases N] [--games N] [--game-base ID] [--ships N]
+//               [--drafts N] [--events N] [--scenario S] [--seed S]
+//               [--pack FILE]
+//
+// DIR (created if missing) receives the map CSVs in seed.sql's layout (star_systems, warplines,
+// hexes, warpline_hexes), CSVs for the games' rows (games, ships, drafts,
+// sightings, game_events) and world.sql, which loads them all. With --pack
+// the map is also compiled into a map pack for 'kh --map-pack'. The same
+// arguments give the same world.
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <sys/stat.h>
+
+#include "app.h"
+#include "game.h"
+#include "map.h"
+#include "mappack.h"
+#include "spatial.h"
+#include "typs.h"
+
+#define KH_WG_MAX_HEXES 1000000 // hex ids stay within 8 characters
+#define KH_WG_MAX_CODE 99       // ship ids are 1..99 per type and side
+#define KH_WG_NEAR 64           // systems a side's ships spread over per base
+
+class WorldArgs
+{
+  public:
+    std::string out;
+    std::string pack;
+    std::string scenario = "basic";
+    int map_id = 2;
+    int hexes = 10000;
+    int systems = 0; // 0: one per 12 hexes, about the seed map's density
+    double degree = 1.7;
+    int bases = 3;
+    int games = 1;
+    int game_base = 1000;
+    int ships = 40;
+    int drafts = 4;
+    int events = 500;
+    unsigned long long seed = 1;
+};
+
+// The hexes as rows of 'width', in the offset layout map_view.html draws
+// (row = q + r - (width + 1), col = q - (row + 2) / 2), so every q and r
+// is at least 1.
+class Board
+{
+  public:
+    explicit Board(int hexes) : count(hexes)
+    {
+        width = (int)std::ceil(std::sqrt((double)hexes));
+        height = (hexes + width - 1) / width;
+        digits = std::max(2, (int)std::to_string(width + height / 2 + 2).size());
+    }
+    int q_of(int i) const
+    {
+        return i % width + (i / width + 2) / 2;
+    }
+    int r_of(int i) const
+    {
+        return i / width + width + 1 - q_of(i);
+    }
+    // The hex at (q, r), or -1 off the board.
+    int at(int q, int r) const
+    {
+        int row = q + r - (width + 1);
+        if (row < 0)
+            return -1;
+        int col = q - (row + 2) / 2;
+        if (col < 0 || col >= width || (long long)row * width + col >= count)
+            return -1;
+        return row * width + col;
+    }
+    std::string id(int i) const
+    {
+        char buf[16];
+        std::snprintf(buf, sizeof(buf), "%0*d%0*d", digits, q_of(i), digits,
+                      r_of(i));
+        return buf;
+    }
+
+    int count;
+    int width;
+    int height;
+    int digits;
+};
+
+static int hex_distance(const Board &b, int x, int y)
+{
+    int dq = b.q_of(x) - b.q_of(y);
+    int dr = b.r_of(x) - b.r_of(y);
+    return (std::abs(dq) + std::abs(dr) + std::abs(dq + dr)) / 2;
+}
+
+// Hexes on the straight line from x to y, both included.
+static std::vector<int> hex_line(const Board &b, int x, int y)
+{
+    int n = hex_distance(b, x, y);
+    std::vector<int> out;
+    for (int i = 0; i <= n; i++)
+    {
+        double t = n ? (double)i / n : 0.0;
+        // Nudged off the hex edges so that ties round the same way.
+        double fq = b.q_of(x) + (b.q_of(y) - b.q_of(x)) * t + 1e-6;
+        double fr = b.r_of(x) + (b.r_of(y) - b.r_of(x)) * t + 1e-6;
+        double fs = -fq - fr;
+        double q = std::round(fq), r = std::round(fr), s = std::round(fs);
+        double dq = std::fabs(q - fq), dr = std::fabs(r - fr),
+               ds = std::fabs(s - fs);
+        if (dq > dr && dq > ds)
+            q = -r - s;
+        else if (dr > ds)
+            r = -q - s;
+        int h = b.at((int)q, (int)r);
+        if (h >= 0 && (out.empty() || out.back() != h))
+            out.push_back(h);
+    }
+    return out;
+}
+
+// Systems in 2-5 syllables, unique by construction (bijective base 16).
+static std::string system_name(int v)
+{
+    static const char *SYL[16] = {"KA", "RU", "SI", "NU", "MA", "BE",
+                                  "LA", "TO", "ZI", "DU", "ER", "IS",
+                                  "UR", "AK", "EN", "OL"};
+    std::string s;
+    for (v += 17; v > 0; v = (v - 1) / 16)
+        s.insert(0, SYL[(v - 1) % 16]);
+    return s;
+}
+
+static std::string ship_name(int i)
+{
+    static const char *NAMES[] = {"Resolute", "Valiant",  "Meridian",
+                                  "Tenacity", "Corsair",  "Halcyon",
+                                  "Vigilant", "Aurora",   "Perihelion",
+                                  "Sentinel", "Nomad",    "Zephyr"};
+    const int n = sizeof(NAMES) / sizeof(NAMES[0]);
+    return std::string(NAMES[i % n]) + " " + std::to_string(i / n + 1);
+}
+
+// A field for the game tables' CSVs, which world.sql loads with
+// OPTIONALLY ENCLOSED BY '"' and MySQL's backslash escapes.
+static std::string csv(const std::string &v)
+{
+    if (v.find_first_of(",\"\\\n") == std::string::npos)
+        return v;
+    std::string out = "\"";
+    for (char c : v)
+    {
+        if (c == '\n')
+            out += "\\n";
+        else
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+static std::string csv_or_null(const std::string &v)
+{
+    return v.empty() ? "\\N" : csv(v);
+}
+
+class CsvFile
+{
+  public:
+    CsvFile(const std::string &dir, const char *name)
+        : path(dir + "/" + name), out(path.c_str())
+    {
+        if (!out)
+            throw std::runtime_error("cannot write " + path);
+    }
+    void close()
+    {
+        out.close();
+        if (!out)
+            throw std::runtime_error("short write to " + path);
+    }
+
+    std::string path;
+    std::ofstream out;
+};
+
+// The generated map: systems[i] is the hex it sits on, links index systems.
+class World
+{
+  public:
+    std::vector<int> systems;
+    std::vector<std::string> names;
+    std::vector<char> base_owner;
+    std::vector<std::pair<int, int>> links;
+    std::vector<int> near[2]; // systems each side's ships are found in
+};
+
+// Up to 'k' systems nearest to hex 'h' (itself included if it is one).
+static std::vector<int> nearest(const Board &b, const HexGrid &grid,
+                                const World &w, int h, int k)
+{
+    int q = b.q_of(h), r = b.r_of(h);
+    std::vector<int> found;
+    for (int radius = 4;; radius *= 2)
+    {
+        found = grid.query(q - radius, r - radius, q + radius, r + radius);
+        if ((int)found.size() > k || radius > b.width + b.height)
+            break;
+    }
+    std::sort(found.begin(), found.end(), [&](int x, int y) {
+        int dx = hex_distance(b, h, w.systems[x]);
+        int dy = hex_distance(b, h, w.systems[y]);
+        return dx != dy ? dx < dy : x < y;
+    });
+    if ((int)found.size() > k)
+        found.resize(k);
+    return found;
+}
+
+static int find_root(std::vector<int> &parent, int x)
+{
+    while (parent[x] != x)
+        x = parent[x] = parent[parent[x]];
+    return x;
+}
+
+static World generate_map(const WorldArgs &a, const Board &b,
+                          std::mt19937_64 &rng)
+{
+    World w;
+
+    // Systems on random hexes, none adjacent to another.
+    HexGrid grid;
+    std::uniform_int_distribution<int> any_hex(0, b.count - 1);
+    for (long long tries = 0;
+         (int)w.systems.size() < a.systems && tries < 50LL * a.systems;
+         tries++)
+    {
+        int h = any_hex(rng);
+        int q = b.q_of(h), r = b.r_of(h);
+        if (!grid.query(q - 1, r - 1, q + 1, r + 1).empty())
+            continue;
+        grid.insert((int)w.systems.size(), q, r, q, r);
+        w.systems.push_back(h);
+    }
+    int n = (int)w.systems.size();
+    if (n < a.systems)
+        throw std::runtime_error("could only place " + std::to_string(n) +
+                                 " systems; use fewer or more hexes");
+
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    for (int i = 0; i < n; i++)
+        w.names.push_back(system_name(order[i]));
+
+    // Bases: A's at the left edge of the board, B's at the right.
+    w.base_owner.assign(n, 0);
+    std::vector<int> by_col(order);
+    std::sort(by_col.begin(), by_col.end(), [&](int x, int y) {
+        int cx = w.systems[x] % b.width, cy = w.systems[y] % b.width;
+        return cx != cy ? cx < cy : x < y;
+    });
+    for (int i = 0; i < a.bases; i++)
+    {
+        w.base_owner[by_col[i]] = 'A';
+        w.base_owner[by_col[n - 1 - i]] = 'B';
+    }
+
+    // Warplines: each system's few nearest are candidates. A spanning
+    // forest of the shortest goes in first, so the map joins up as far as
+    // the count allows, then the shortest of the rest.
+    int want = (int)std::lround(n * a.degree / 2);
+    int k = std::max(2, (int)std::ceil(a.degree) + 2);
+    std::vector<std::pair<int, std::pair<int, int>>> cand;
+    for (int i = 0; i < n; i++)
+        for (int j : nearest(b, grid, w, w.systems[i], k + 1))
+            if (j != i)
+                cand.push_back(std::make_pair(
+                    hex_distance(b, w.systems[i], w.systems[j]),
+                    std::make_pair(std::min(i, j), std::max(i, j))));
+    std::sort(cand.begin(), cand.end());
+    cand.erase(std::unique(cand.begin(), cand.end()), cand.end());
+
+    std::vector<int> parent(n);
+    std::iota(parent.begin(), parent.end(), 0);
+    std::vector<char> used(cand.size(), 0);
+    for (size_t i = 0; i < cand.size() && (int)w.links.size() < want; i++)
+    {
+        int x = find_root(parent, cand[i].second.first);
+        int y = find_root(parent, cand[i].second.second);
+        if (x == y)
+            continue;
+        parent[x] = y;
+        used[i] = 1;
+        w.links.push_back(cand[i].second);
+    }
+    for (size_t i = 0; i < cand.size() && (int)w.links.size() < want; i++)
+        if (!used[i])
+            w.links.push_back(cand[i].second);
+    std::sort(w.links.begin(), w.links.end());
+
+    for (int i = 0; i < n; i++)
+        if (w.base_owner[i])
+            for (int j : nearest(b, grid, w, w.systems[i], KH_WG_NEAR))
+                w.near[w.base_owner[i] == 'A' ? 0 : 1].push_back(j);
+    return w;
+}
+
+static void write_map(const WorldArgs &a, const Board &b, const World &w)
+{
+    std::string m = std::to_string(a.map_id) + ",";
+
+    CsvFile sys(a.out, "star_systems.csv");
+    for (size_t i = 0; i < w.systems.size(); i++)
+        sys.out << m << b.id(w.systems[i]) << "," << w.names[i] << ","
+                << (w.base_owner[i] ? 1 : 0) << ","
+                << (w.base_owner[i] ? std::string(1, w.base_owner[i]) : "")
+                << "\n";
+    sys.close();
+
+    CsvFile hx(a.out, "hexes.csv");
+    for (int i = 0; i < b.count; i++)
+        hx.out << m << b.id(i) << "," << b.q_of(i) << "," << b.r_of(i)
+               << "\n";
+    hx.close();
+
+    // Warpline ids are 1.. in file order; world.sql shifts them past the
+    // ones already in the table.
+    CsvFile wl(a.out, "warplines.csv");
+    CsvFile wh(a.out, "warpline_hexes.csv");
+    for (size_t i = 0; i < w.links.size(); i++)
+    {
+        int x = w.systems[w.links[i].first];
+        int y = w.systems[w.links[i].second];
+        wl.out << m << b.id(x) << "," << b.id(y) << "\n";
+        for (int h : hex_line(b, x, y))
+            wh.out << m << i + 1 << "," << b.id(h) << "\n";
+    }
+    wl.close();
+    wh.close();
+}
+
+static void write_pack(const WorldArgs &a, const Board &b, const World &w)
+{
+    std::vector<MapSystemRow> systems;
+    for (size_t i = 0; i < w.systems.size(); i++)
+    {
+        MapSystemRow s;
+        s.hex = b.id(w.systems[i]);
+        s.name = w.names[i];
+        s.is_base = w.base_owner[i] != 0;
+        s.base_owner = w.base_owner[i];
+        systems.push_back(s);
+    }
+    std::vector<std::pair<std::string, std::string>> links;
+    MapGeometry g;
+    for (int i = 0; i < b.count; i++)
+    {
+        MapHex h;
+        h.hex = b.id(i);
+        h.q = b.q_of(i);
+        h.r = b.r_of(i);
+        g.hexes.push_back(h);
+    }
+    std::sort(g.hexes.begin(), g.hexes.end(),
+              [](const MapHex &x, const MapHex &y) { return x.hex < y.hex; });
+    for (size_t i = 0; i < w.links.size(); i++)
+    {
+        int x = w.systems[w.links[i].first];
+        int y = w.systems[w.links[i].second];
+        links.push_back(std::make_pair(b.id(x), b.id(y)));
+        MapWarpline l;
+        l.id = (int)i + 1;
+        l.a_hex = b.id(x);
+        l.b_hex = b.id(y);
+        for (int h : hex_line(b, x, y))
+            l.path.push_back(b.id(h));
+        std::sort(l.path.begin(), l.path.end());
+        g.warplines.push_back(l);
+    }
+    GameMap m = build_map(systems, links);
+    m.map_id = a.map_id;
+    build_map_pack(m, g, a.map_id, a.pack);
+}
+
+// One game's fleets, drafts and history. Ships are placed and moved about
+// near their own side's bases; the history is 'start' followed by deploys
+// and 'next's, with the state each command left recorded as kh would.
+static void generate_game(const WorldArgs &a, const Board &b, const World &w,
+                          int game_id, std::mt19937_64 &rng, CsvFile &games,
+                          CsvFile &ships, CsvFile &drafts,
+                          CsvFile &sightings, CsvFile &events)
+{
+    auto roll = [&](int lo, int hi) {
+        return std::uniform_int_distribution<int>(lo, hi)(rng);
+    };
+    auto place = [&](int side, ShipRow &sh) {
+        int sys = w.near[side][roll(0, (int)w.near[side].size() - 1)];
+        sh.at_system = w.names[sys];
+        sh.at_hex = b.id(w.systems[sys]);
+    };
+
+    std::vector<ShipRow> fleet[2];
+    std::vector<DraftRow> draft[2];
+    for (int side = 0; side < 2; side++)
+    {
+        int nw = std::min(KH_WG_MAX_CODE, (a.ships + 1) / 2);
+        int ns = a.ships - nw;
+        for (int i = 0; i < nw + ns; i++)
+        {
+            ShipRow sh;
+            bool war = i < nw;
+            sh.code = (war ? "W" : "S") + std::to_string(war ? i + 1 : i - nw + 1);
+            sh.name = ship_name(i);
+            sh.attr.type = war ? 'W' : 'S';
+            sh.attr.PD = roll(0, 2);
+            sh.attr.B = roll(0, war ? 3 : 2);
+            sh.attr.S = roll(0, 2);
+            sh.attr.T = roll(0, war ? 2 : 1);
+            sh.attr.M = 3 * roll(0, war ? 2 : 1);
+            sh.attr.SR = war ? roll(0, 3) : 0;
+            if (roll(0, 99) < 85)
+                place(side, sh);
+            fleet[side].push_back(sh);
+        }
+        // Some systemships ride in warships with rack space.
+        std::vector<int> room(nw);
+        for (int i = 0; i < nw; i++)
+            room[i] = fleet[side][i].attr.SR;
+        for (int i = nw, wi = 0; i < nw + ns; i++)
+        {
+            while (wi < nw && room[wi] == 0)
+                wi++;
+            if (wi == nw)
+                break;
+            if (roll(0, 3) != 0)
+                continue;
+            fleet[side][i].racked_in = fleet[side][wi].code;
+            fleet[side][i].at_system.clear();
+            fleet[side][i].at_hex.clear();
+            room[wi]--;
+        }
+
+        int next_w = nw, next_s = ns;
+        for (int i = 0; i < a.drafts; i++)
+        {
+            DraftRow d;
+            bool war = (i % 2 == 0 && next_w < KH_WG_MAX_CODE) ||
+                       next_s >= KH_WG_MAX_CODE;
+            d.code = (war ? "W" : "S") + std::to_string(war ? ++next_w : ++next_s);
+            d.name = ship_name(nw + ns + i);
+            d.attr.type = war ? 'W' : 'S';
+            d.attr.PD = roll(0, 2);
+            d.attr.B = roll(0, 3);
+            d.attr.S = roll(0, 2);
+            d.attr.T = roll(0, 1);
+            d.attr.M = 3 * roll(0, 1);
+            d.attr.SR = war ? roll(0, 2) : 0;
+            draft[side].push_back(d);
+        }
+    }
+
+    GameState s;
+    s.create_empty_game();
+    s.game_id = game_id;
+    for (int seq = 1; seq <= a.events; seq++)
+    {
+        std::string cmd, result;
+        int side = s.active_player == "B" ? 1 : 0;
+        std::vector<int> movable;
+        for (size_t i = 0; i < fleet[side].size(); i++)
+            if (fleet[side][i].racked_in.empty())
+                movable.push_back((int)i);
+
+        if (seq == 1)
+        {
+            s = new_game_state_for_scenario(a.scenario);
+            s.game_id = game_id;
+            cmd = "start " + a.scenario;
+            result = "Game started: " + a.scenario + ". " + s.notes();
+        }
+        else if (s.phase_index == PH_BUILD_SHIPS && !movable.empty() &&
+                 roll(0, 99) < 60)
+        {
+            ShipRow &sh =
+                fleet[side][movable[roll(0, (int)movable.size() - 1)]];
+            place(side, sh);
+            cmd = "deploy " + sh.code + " " + sh.at_system;
+            result = "Deployed " + sh.name + " - " + sh.code + " to " +
+                     sh.at_system;
+        }
+        else
+        {
+            std::string before = s.phase_name();
+            std::string beforeP = s.active_player;
+            int beforeRound = s.round;
+            if (s.phase_index < PH_END_TURN)
+                s.phase_index++;
+            else
+            {
+                if (s.active_player == "A")
+                    s.active_player = "B";
+                else
+                {
+                    s.active_player = "A";
+                    s.round++;
+                }
+                s.phase_index = PH_BUILD_SHIPS;
+                if (s.scenario == "advanced")
+                    (s.active_player == "A" ? s.bpA : s.bpB) += 10;
+            }
+            cmd = "next";
+            result = "Advanced: " + beforeP + " / " + before + " -> " +
+                     s.active_player + " / " + s.phase_name();
+            if (s.round != beforeRound)
+                result += " (round " + std::to_string(s.round) + ")";
+        }
+        s.version = seq;
+        // The demo users from schema.sql: alice plays A, bob plays B.
+        events.out << game_id << "," << side + 1 << "," << seq << ","
+                   << csv(cmd) << "," << csv(result) << ","
+                   << csv(s.to_json()) << "\n";
+    }
+
+    for (int side = 0; side < 2; side++)
+    {
+        char owner = side ? 'B' : 'A';
+        for (auto &sh : fleet[side])
+        {
+            sh.attr.tech = a.scenario == "advanced" ? roll(0, (s.round - 1) / 4)
+                                                    : 0;
+            sh.built_turn =
+                "R" + std::to_string(roll(1, s.round)) + std::string(1, owner);
+            ships.out << game_id << "," << owner << "," << sh.code << ","
+                      << csv(sh.name) << "," << sh.attr.type << ","
+                      << sh.attr.tech << "," << sh.built_turn << ","
+                      << sh.attr.PD << "," << sh.attr.B << "," << sh.attr.S
+                      << "," << sh.attr.T << "," << sh.attr.M << ","
+                      << sh.attr.SR << "," << csv_or_null(sh.at_system) << ","
+                      << csv_or_null(sh.at_hex) << ","
+                      << csv_or_null(sh.racked_in) << "\n";
+        }
+        for (auto &d : draft[side])
+            drafts.out << game_id << "," << owner << "," << d.code << ","
+                       << csv(d.name) << "," << d.attr.type << ","
+                       << d.attr.PD << "," << d.attr.B << "," << d.attr.S
+                       << "," << d.attr.T << "," << d.attr.M << ","
+                       << d.attr.SR << "\n";
+        // A quarter of the enemy's deployed ships have been seen.
+        char enemy = side ? 'A' : 'B';
+        for (auto &sh : fleet[1 - side])
+            if (!sh.at_system.empty() && roll(0, 3) == 0)
+                sightings.out << game_id << "," << owner << "," << enemy
+                              << "," << sh.code << "," << csv(sh.name) << ","
+                              << sh.attr.type << "," << sh.at_system << ",R"
+                              << roll(1, s.round) << enemy << "\n";
+    }
+
+    std::string cur[2];
+    for (int side = 0; side < 2; side++)
+        if (!draft[side].empty())
+            cur[side] = draft[side].back().code;
+    games.out << game_id << "," << csv_or_null(s.scenario) << ","
+              << csv(s.to_json()) << "," << csv_or_null(cur[0]) << ","
+              << csv_or_null(cur[1]) << "," << s.version << "," << a.map_id
+              << "\n";
+}
+
+static void write_sql(const WorldArgs &a, const World &w)
+{
+    FILE *f = std::fopen((a.out + "/world.sql").c_str(), "w");
+    if (!f)
+        throw std::runtime_error("cannot write " + a.out + "/world.sql");
+    const char *csv_fields = "FIELDS TERMINATED BY ',' OPTIONALLY ENCLOSED BY "
+                             "'\"'\nLINES TERMINATED BY '\\n'\n";
+    std::fprintf(
+        f,
+        "-- Generated by kh-worldgen (seed %llu): map %d with %d systems and "
+        "%d warplines,\n"
+        "-- games %d..%d played on it. Run from this directory after "
+        "schema.sql:\n"
+        "--   mysql --local-infile=1 -u <user> -p khdb < world.sql\n\n"
+        "START TRANSACTION;\n\n"
+        "INSERT INTO maps(id,name) VALUES(%d,'Generated %llu');\n\n"
+        "LOAD DATA LOCAL INFILE 'star_systems.csv'\nINTO TABLE star_systems\n"
+        "FIELDS TERMINATED BY ','\nLINES TERMINATED BY '\\n'\n"
+        "(map_id, hex_id, name, is_base, base_owner);\n\n"
+        "-- warplines.csv numbers its warplines from 1, in file order.\n"
+        "SET @base = (SELECT COALESCE(MAX(id),0) FROM warplines);\n"
+        "SET @n = 0;\n"
+        "LOAD DATA LOCAL INFILE 'warplines.csv'\nINTO TABLE warplines\n"
+        "FIELDS TERMINATED BY ','\nLINES TERMINATED BY '\\n'\n"
+        "(map_id, a_hex, b_hex)\nSET id = @base + (@n := @n + 1);\n\n"
+        "LOAD DATA LOCAL INFILE 'hexes.csv'\nINTO TABLE hexes\n"
+        "FIELDS TERMINATED BY ','\nLINES TERMINATED BY '\\n'\n"
+        "(map_id, hex_id, q, r);\n\n"
+        "LOAD DATA LOCAL INFILE 'warpline_hexes.csv'\nINTO TABLE "
+        "warpline_hexes\n"
+        "FIELDS TERMINATED BY ','\nLINES TERMINATED BY '\\n'\n"
+        "(map_id, @w, hex_id)\nSET warpline_id = @base + @w;\n\n"
+        "LOAD DATA LOCAL INFILE 'games.csv'\nINTO TABLE games\n%s"
+        "(id, scenario, state_json, current_draft_A, current_draft_B, "
+        "version, map_id);\n\n"
+        "LOAD DATA LOCAL INFILE 'ships.csv'\nINTO TABLE ships\n%s"
+        "(game_id, owner, ship_code, ship_name, ship_type, tech_level, "
+        "built_turn,\n pd, beam, screen, tube, missiles, sr, at_system, "
+        "at_hex, racked_in);\n\n"
+        "LOAD DATA LOCAL INFILE 'drafts.csv'\nINTO TABLE drafts\n%s"
+        "(game_id, owner, ship_code, ship_name, ship_type, pd, beam, screen, "
+        "tube,\n missiles, sr);\n\n"
+        "LOAD DATA LOCAL INFILE 'sightings.csv'\nINTO TABLE sightings\n%s"
+        "(game_id, observer_owner, subject_owner, ship_code, ship_name, "
+        "ship_type,\n at_system, last_seen_turn);\n\n"
+        "LOAD DATA LOCAL INFILE 'game_events.csv'\nINTO TABLE game_events\n%s"
+        "(game_id, user_id, seq, command_text, result_text, state_json);\n\n"
+        "COMMIT;\n",
+        a.seed, a.map_id, (int)w.systems.size(), (int)w.links.size(),
+        a.game_base, a.game_base + a.games - 1, a.map_id, a.seed, csv_fields,
+        csv_fields, csv_fields, csv_fields, csv_fields);
+    if (std::fclose(f) != 0)
+        throw std::runtime_error("short write to " + a.out + "/world.sql");
+}
+
+int main(int argc, char **argv)
+{
+    WorldArgs a;
+
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            std::string k = argv[i];
+            auto next = [&]() -> std::string {
+                if (i + 1 >= argc)
+                    throw std::runtime_error("missing arg for " + k);
+                return argv[++i];
+            };
+            if (k == "--out")
+                a.out = next();
+            else if (k == "--pack")
+                a.pack = next();
+            else if (k == "--scenario")
+                a.scenario = next();
+            else if (k == "--map")
+                a.map_id = std::atoi(next().c_str());
+            else if (k == "--hexes")
+                a.hexes = std::atoi(next().c_str());
+            else if (k == "--systems")
+                a.systems = std::atoi(next().c_str());
+            else if (k == "--degree")
+                a.degree = std::atof(next().c_str());
+            else if (k == "--bases")
+                a.bases = std::atoi(next().c_str());
+            else if (k == "--games")
+                a.games = std::atoi(next().c_str());
+            else if (k == "--game-base")
+                a.game_base = std::atoi(next().c_str());
+            else if (k == "--ships")
+                a.ships = std::atoi(next().c_str());
+            else if (k == "--drafts")
+                a.drafts = std::atoi(next().c_str());
+            else if (k == "--events")
+                a.events = std::atoi(next().c_str());
+            else if (k == "--seed")
+                a.seed = std::strtoull(next().c_str(), NULL, 10);
+            else
+                throw std::runtime_error("unknown arg " + k);
+        }
+        if (a.out.empty())
+            throw std::runtime_error("--out is required");
+        if (a.hexes < 100 || a.hexes > KH_WG_MAX_HEXES)
+            throw std::runtime_error("--hexes must be 100.." +
+                                     std::to_string(KH_WG_MAX_HEXES));
+        if (a.systems == 0)
+            a.systems = a.hexes / 12;
+        if (a.systems < 2 * a.bases + 2 || a.systems > a.hexes / 8)
+            throw std::runtime_error("--systems must be " +
+                                     std::to_string(2 * a.bases + 2) + ".." +
+                                     std::to_string(a.hexes / 8));
+        if (a.bases < 1 || a.degree < 0 || a.games < 0 || a.events < 1 ||
+            a.game_base < 1)
+            throw std::runtime_error("bad --bases, --degree, --games, "
+                                     "--events or --game-base");
+        if (a.ships < 0 || a.drafts < 0 ||
+            a.ships + a.drafts > 2 * KH_WG_MAX_CODE)
+            throw std::runtime_error("--ships plus --drafts must be 0.." +
+                                     std::to_string(2 * KH_WG_MAX_CODE) +
+                                     " per side");
+        if (a.scenario != "learning" && a.scenario != "basic" &&
+            a.scenario != "advanced")
+            throw std::runtime_error("--scenario must be "
+                                     "learning|basic|advanced");
+
+        if (mkdir(a.out.c_str(), 0755) != 0 && errno != EEXIST)
+            throw std::runtime_error("cannot create " + a.out + ": " +
+                                     std::strerror(errno));
+
+        std::mt19937_64 rng(a.seed);
+        Board board(a.hexes);
+        World w = generate_map(a, board, rng);
+        write_map(a, board, w);
+        if (!a.pack.empty())
+            write_pack(a, board, w);
+
+        CsvFile games(a.out, "games.csv");
+        CsvFile ships(a.out, "ships.csv");
+        CsvFile drafts(a.out, "drafts.csv");
+        CsvFile sightings(a.out, "sightings.csv");
+        CsvFile events(a.out, "game_events.csv");
+        for (int g = 0; g < a.games; g++)
+            generate_game(a, board, w, a.game_base + g, rng, games, ships,
+                          drafts, sightings, events);
+        games.close();
+        ships.close();
+        drafts.close();
+        sightings.close();
+        events.close();
+        write_sql(a, w);
+
+        std::printf("wrote %s: map %d with %d hexes, %d systems, %d "
+                    "warplines; %d games, %d ships and %d events each%s%s\n",
+                    a.out.c_str(), a.map_id, board.count,
+                    (int)w.systems.size(), (int)w.links.size(), a.games,
+                    2 * a.ships, a.events, a.pack.empty() ? "" : "; pack ",
+                    a.pack.c_str());
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "kh-worldgen: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
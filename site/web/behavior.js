@@ -112,6 +112,13 @@
     setText("stPeerPhase", peerPhase);
 
     setText("stGameId", st ? String(st.gameId) : "-");
+
+    // Show the map of the game we're seated at.
+    const frame = $("mapFrame");
+    if (frame && st && st.gameId) {
+      const src = "map_view.html?game=" + st.gameId;
+      if (frame.getAttribute("src") !== src) frame.setAttribute("src", src);
+    }
     setText("stScenario", st ? (st.scenario || "(none)") : "-");
     setText("stRound", st ? String(st.round) : "-");
     setText("stPlayer", st ? st.activePlayer : "-");
@@ -132,8 +139,11 @@
   }
 
   async function apiFetchState() {
-    const j = await apiJson("state", "GET", null, true);
-    S.state = j.state;
+    // Ask only for what changed since the version we hold; the server sends
+    // the full state instead when it no longer has that version.
+    const have = (S.state && typeof S.state.version === "number") ? S.state.version : null;
+    const j = await apiJson(have === null ? "state" : ("state?since=" + have), "GET", null, true);
+    S.state = j.delta ? Object.assign({}, S.state, j.delta) : j.state;
     S.self = j.self || null;
     S.peer = j.peer || null;
     renderStatus();
@@ -144,6 +154,7 @@
     const j = await apiJson("login", "POST", { username: username, password: password }, false);
     S.username = username;
     S.token = j.token;
+    S.state = null;
     setLoginBadge();
     appendLine("Login OK.", "line-good");
     await apiFetchState();
@@ -153,6 +164,7 @@
   async function apiLogout() {
     try { await apiJson("logout", "POST", {}, true); } catch (e) { /* ignore */ }
     S.token = null;
+    S.state = null;
     S.username = null;
     S.self = null;
     S.peer = null;
@@ -178,6 +190,12 @@
     return j;
   }
 
+  // Systems and ship codes that begin with 'prefix', for Tab completion.
+  async function apiComplete(prefix) {
+    const j = await apiJson("complete?prefix=" + encodeURIComponent(prefix), "GET", null, true);
+    return (j.ships || []).concat(j.systems || []);
+  }
+
   function toggleMapView() {
     const mv = $("mapView");
     const log = $("consoleLog");
@@ -203,6 +221,7 @@
     apiLogout: apiLogout,
     apiFetchState: apiFetchState,
     apiCommand: apiCommand,
+    apiComplete: apiComplete,
     toggleMapView: toggleMapView
   };
 
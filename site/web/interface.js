@@ -95,9 +95,45 @@ window.KEPLERHORIZON = window.KEPLERHORIZON || {};
       }
     }
 
+    // Tab completes the last word: fully if only one name fits, else as
+    // far as the names agree, listing them.
+    async function completeCmd() {
+      const m = inp.value.match(/(\S*)$/);
+      const word = m ? m[1] : "";
+      if (!word) {
+         return;
+      }
+      let names;
+      try {
+        names = await B.apiComplete(word);
+      } catch (e) {
+        return;
+      }
+      if (!names.length) {
+         return;
+      }
+      let common = names[0].toUpperCase();
+      for (const n of names) {
+        let i = 0;
+        while (i < common.length && common[i] === n.toUpperCase()[i]) i++;
+        common = common.slice(0, i);
+      }
+      const done = (names.length === 1) ? names[0] + " " : names[0].slice(0, common.length);
+      if (done.length >= word.length) {
+        inp.value = inp.value.slice(0, inp.value.length - word.length) + done;
+      }
+      if (names.length > 1) {
+        B.appendLine(names.join("  "), "line-muted");
+      }
+    }
+
     send.addEventListener("click", runCmd);
     inp.addEventListener("keydown", (e) => {
       if (e.key === "Enter") runCmd();
+      else if (e.key === "Tab") {
+        e.preventDefault();
+        completeCmd();
+      }
     });
 
     B.appendLine("Kepler's Horizon client loaded.", "line-muted");